@@ -1,24 +1,42 @@
 // system headers
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <fstream>
+#include <cstdint>
+#include <cctype>
 
-// define bitboard data type
-#define U64 unsigned long long
+// memory mapped files
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-class CBoard {
-    U64 whitePawns;
-    U64 whiteKnights;
-    U64 whiteBishops;
-    U64 whiteRooks;
-    U64 whiteQueens;
-    U64 whiteKing;
+// x86 cpu feature detection
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define PEXT_SUPPORTED 1
+#define AVX2_SUPPORTED 1
+#else
+#define PEXT_SUPPORTED 0
+#define AVX2_SUPPORTED 0
+#endif
 
-    U64 blackPawns;
-    U64 blackKnights;
-    U64 blackBishops;
-    U64 blackRooks;
-    U64 blackQueens;
-    U64 blackKing;
-};
+// define bitboard data type
+#define U64 unsigned long long
 
 /*********************\
  ======================
@@ -27,33 +45,64 @@ class CBoard {
 \*********************/
 
 // set/get/pop macros
-#define get_bit(bitboard, square) (bitboard & (1ULL << square))
-#define set_bit(bitboard, square) (bitboard |= (1ULL << square))
-#define pop_bit(bitboard, square) (get_bit(bitboard, square) ? (bitboard ^= (1ULL << square)) : 0)
+#define get_bit(bitboard, square) ((bitboard) & (1ULL << (square)))
+#define set_bit(bitboard, square) ((bitboard) |= (1ULL << (square)))
+#define pop_bit(bitboard, square) (get_bit(bitboard, square) ? ((bitboard) ^= (1ULL << (square))) : 0)
 
 // count bits
-static inline int countBits(U64 bitboard) {
-    int count = 0;
-    // until no bits on board are set (uncounted)
-    while (bitboard) {
-        // reset least significant bit
-        bitboard &= bitboard - 1;
-        count++;
-    }
-    return count;
+static constexpr int countBits(U64 bitboard) {
+#if defined(__GNUC__) || defined(__clang__)
+    // single popcnt instruction when built with popcnt support
+    return __builtin_popcountll(bitboard);
+#else
+    // portable SWAR fallback (also usable at compile time)
+    bitboard -= (bitboard >> 1) & 0x5555555555555555ULL;
+    bitboard = (bitboard & 0x3333333333333333ULL) + ((bitboard >> 2) & 0x3333333333333333ULL);
+    bitboard = (bitboard + (bitboard >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int) ((bitboard * 0x0101010101010101ULL) >> 56);
+#endif
 }
 
+// de Bruijn sequence and lookup for portable bit scan
+constexpr U64 ls1bDeBruijn = 0x03f79d71b4cb0a89ULL;
+constexpr int ls1bDeBruijnIndex[64] = {
+        0, 1, 48, 2, 57, 49, 28, 3,
+        61, 58, 50, 42, 38, 29, 17, 4,
+        62, 55, 59, 36, 53, 51, 43, 22,
+        45, 39, 33, 30, 24, 18, 12, 5,
+        63, 47, 56, 27, 60, 41, 37, 16,
+        54, 35, 52, 21, 44, 32, 23, 11,
+        46, 26, 40, 15, 34, 20, 31, 10,
+        25, 14, 19, 9, 13, 8, 7, 6
+};
+
 // get index of least significant first bit index
-static inline int ls1bIndex(U64 bitboard) {
+static constexpr int ls1bIndex(U64 bitboard) {
     // ensure bitboard has bits set
     if (bitboard) {
-        return countBits((bitboard & -bitboard) - 1);
+#if defined(__GNUC__) || defined(__clang__)
+        // single bsf/tzcnt instruction
+        return __builtin_ctzll(bitboard);
+#else
+        // isolate LS1B and hash it with de Bruijn multiplication
+        return ls1bDeBruijnIndex[((bitboard & -bitboard) * ls1bDeBruijn) >> 58];
+#endif
     } else {
         // return illegal bit index
         return -1;
     }
 }
 
+// get index of least significant first bit and pop it (bitboard must not be empty)
+static constexpr int popLs1bIndex(U64 &bitboard) {
+    int square = ls1bIndex(bitboard);
+
+    // reset least significant bit
+    bitboard &= bitboard - 1;
+
+    return square;
+}
+
 // board squares
 enum {
     a8, b8, c8, d8, e8, f8, g8, h8,
@@ -63,17 +112,17 @@ enum {
     a4, b4, c4, d4, e4, f4, g4, h4,
     a3, b3, c3, d3, e3, f3, g3, h3,
     a2, b2, c2, d2, e2, f2, g2, h2,
-    a1, b1, c1, d1, e1, f1, g1, h1
+    a1, b1, c1, d1, e1, f1, g1, h1, no_sq
 };
 
-// sides to move
+// sides to move (both indexes the total occupancy)
 enum {
-    white, black
+    white, black, both
 };
 
-// rook bishop enum
+// piece types
 enum {
-    rook, bishop
+    pawn, knight, bishop, rook, queen, king
 };
 
 const char *squareToCoordinates[] = {
@@ -117,42 +166,144 @@ void printBitboard(U64 bitboard) {
     printf("     Bitboard: %llud\n\n ", bitboard);
 }
 
+// get time in nanoseconds
+static inline long long getTimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /*********************\
  ======================
-        Attacks
+      Statistics
  ======================
 \*********************/
 
-// not in 'a' file constant
-const U64 not_a_file = 18374403900871474942ULL;
-// not in 'h' file constant
-const U64 not_h_file = 9187201950435737471ULL;
-const U64 not_hg_file = 4557430888798830399ULL;
-const U64 not_ab_file = 18229723555195321596ULL;
+// search hot path counters and timers are compiled in with SEARCH_STATS only (the timers cost more than what they time)
+#ifdef SEARCH_STATS
+#define SEARCH_STATS_ENABLED 1
+#else
+#define SEARCH_STATS_ENABLED 0
+#endif
 
-// pawn attack table
-U64 pawnAttacks[2][64];
+// beta cutoffs are counted by move index, the last slot takes every later move
+#define STATS_CUTOFF_SLOTS 8
 
-// knight attack table
-U64 knightAttacks[64];
+// hot path counters of one search thread (only written by the owning thread, summed on demand)
+struct SearchStats {
+    std::atomic<U64> qnodes{0ULL};
 
-// king attack table
-U64 kingAttacks[64];
+    // tt stores evicting an entry of another position
+    std::atomic<U64> ttCollisions{0ULL};
 
-// bishop attack masks
-U64 bishopMasks[64];
+    std::atomic<U64> movegenCalls{0ULL};
+    std::atomic<U64> seeCalls{0ULL};
+    std::atomic<U64> evalCalls{0ULL};
+    std::atomic<U64> cutoffsByIndex[STATS_CUTOFF_SLOTS]{};
+
+    // nanoseconds spent in move generation and evaluation
+    std::atomic<U64> movegenNs{0ULL};
+    std::atomic<U64> evalNs{0ULL};
+};
 
-// bishop attacks table[square][occupancies]
-U64 bishopAttacks[64][512];
+// stats of the search running on this thread (nullptr outside of searches, perft and tools aren't counted)
+thread_local SearchStats *threadStats = nullptr;
 
-// rook attack masks
-U64 rookMasks[64];
+// add to stat owned by calling thread (no atomic read-modify-write needed)
+static inline void addStat(std::atomic<U64> &stat, U64 value) {
+    stat.store(stat.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// adds the time of its scope to a stats timer
+struct StatsTimer {
+    std::atomic<U64> SearchStats::*timer;
+    long long start;
 
-// rook attacks table[square][occupancies]
-U64 rookAttacks[64][4096];
+    explicit StatsTimer(std::atomic<U64> SearchStats::*timer) : timer(timer), start(threadStats ? getTimeNs() : 0) {}
+
+    ~StatsTimer() {
+        if (threadStats) addStat(threadStats->*timer, getTimeNs() - start);
+    }
+};
+
+// search stats summed over threads (and searches), plain copyable values
+struct StatsTotals {
+    U64 searches = 0ULL;
+    U64 nodes = 0ULL;
+    U64 qnodes = 0ULL;
+    U64 ttProbes = 0ULL;
+    U64 ttHits = 0ULL;
+    U64 ttCollisions = 0ULL;
+    U64 movegenCalls = 0ULL;
+    U64 seeCalls = 0ULL;
+    U64 evalCalls = 0ULL;
+    U64 cutoffs = 0ULL;
+    U64 cutoffsByIndex[STATS_CUTOFF_SLOTS] = {};
+    U64 movegenNs = 0ULL;
+    U64 evalNs = 0ULL;
+    U64 searchNs = 0ULL;
+
+    StatsTotals &operator+=(const StatsTotals &other) {
+        searches += other.searches;
+        nodes += other.nodes;
+        qnodes += other.qnodes;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        ttCollisions += other.ttCollisions;
+        movegenCalls += other.movegenCalls;
+        seeCalls += other.seeCalls;
+        evalCalls += other.evalCalls;
+        cutoffs += other.cutoffs;
+        for (int i = 0; i < STATS_CUTOFF_SLOTS; i++) cutoffsByIndex[i] += other.cutoffsByIndex[i];
+        movegenNs += other.movegenNs;
+        evalNs += other.evalNs;
+        searchNs += other.searchNs;
+        return *this;
+    }
+};
+
+// stats as a json object
+std::string statsToJson(const StatsTotals &stats) {
+    char buffer[640];
+    std::string cutoffs;
+
+    for (int i = 0; i < STATS_CUTOFF_SLOTS; i++) {
+        cutoffs += (i ? "," : "") + std::to_string(stats.cutoffsByIndex[i]);
+    }
+
+    snprintf(buffer, sizeof(buffer),
+             "{\"searches\":%llu,\"nodes\":%llu,\"qnodes\":%llu,\"tt_probes\":%llu,\"tt_hits\":%llu,"
+             "\"tt_collisions\":%llu,\"movegen_calls\":%llu,\"see_calls\":%llu,\"eval_calls\":%llu,"
+             "\"cutoffs\":%llu,\"cutoffs_by_index\":[%s],\"movegen_ms\":%.3f,\"eval_ms\":%.3f,\"search_ms\":%.3f}",
+             stats.searches, stats.nodes, stats.qnodes, stats.ttProbes, stats.ttHits, stats.ttCollisions,
+             stats.movegenCalls, stats.seeCalls, stats.evalCalls, stats.cutoffs, cutoffs.c_str(), stats.movegenNs / 1e6,
+             stats.evalNs / 1e6, stats.searchNs / 1e6);
+
+    return buffer;
+}
+
+#if SEARCH_STATS_ENABLED
+#define stats_add(stat, value) do { if (threadStats) addStat(threadStats->stat, value); } while (0)
+#define stats_timer(timer) StatsTimer statsTimer(&SearchStats::timer)
+#else
+#define stats_add(stat, value) do {} while (0)
+#define stats_timer(timer) do {} while (0)
+#endif
+
+/*********************\
+ ======================
+        Attacks
+ ======================
+\*********************/
+
+// not in 'a' file constant
+constexpr U64 not_a_file = 18374403900871474942ULL;
+// not in 'h' file constant
+constexpr U64 not_h_file = 9187201950435737471ULL;
+constexpr U64 not_hg_file = 4557430888798830399ULL;
+constexpr U64 not_ab_file = 18229723555195321596ULL;
 
 // relevant occupancy bitcount for every square on board
-const int bishopRelevantBits[64] = {
+constexpr int bishopRelevantBits[64] = {
         6, 5, 5, 5, 5, 5, 5, 6,
         5, 5, 5, 5, 5, 5, 5, 5,
         5, 5, 7, 7, 7, 7, 5, 5,
@@ -163,7 +314,7 @@ const int bishopRelevantBits[64] = {
         6, 5, 5, 5, 5, 5, 5, 6,
 };
 
-const int rookRelevantBits[64] = {
+constexpr int rookRelevantBits[64] = {
         12, 11, 11, 11, 11, 11, 11, 12,
         11, 10, 10, 10, 10, 10, 10, 11,
         11, 10, 10, 10, 10, 10, 10, 11,
@@ -174,75 +325,75 @@ const int rookRelevantBits[64] = {
         12, 11, 11, 11, 11, 11, 11, 12,
 };
 
-const U64 rookMagicNumbers[64] =
+constexpr U64 rookMagicNumbers[64] =
         {
-                0x98060280800000ULL,
-                0x200102080410000ULL,
-                0x1084003808010000ULL,
-                0x240040040880000ULL,
-                0x400024020140206ULL,
-                0x400a11002040000ULL,
-                0x400100140844800ULL,
-                0x2080003444810200ULL,
-                0x3010200800000ULL,
-                0x4006422210000ULL,
-                0x944100402080000ULL,
-                0x8104100012c0a000ULL,
-                0x4800800400088000ULL,
-                0x802200040000ULL,
-                0x800108024800ULL,
-                0x40200092004400ULL,
-                0xe40840026010000ULL,
-                0x10020c020100002ULL,
-                0x2010040014ULL,
-                0x10240014088036ULL,
-                0x818080040b0000ULL,
-                0x805000a010020000ULL,
-                0x4250012041800400ULL,
-                0x4001200800409200ULL,
-                0x100010a08040000ULL,
-                0x20601008003ULL,
-                0x20000043a0008001ULL,
-                0x8000030030082001ULL,
-                0x2808083444ULL,
-                0x10e701041201800ULL,
-                0x4480000c02020000ULL,
-                0x124010108000ULL,
-                0x600108400410001ULL,
-                0x6000043000200002ULL,
-                0xa804850c04004002ULL,
-                0x14008080000ULL,
-                0x4000240004004001ULL,
-                0x2004120008101000ULL,
-                0x10000c4285003000ULL,
-                0xc00000020100d000ULL,
-                0x1c0040a021220006ULL,
-                0x8000004020028011ULL,
-                0x8060c20003ULL,
-                0x8020008400440001ULL,
-                0xa62040000ULL,
-                0x1418000202060010ULL,
-                0x2404000401010000ULL,
-                0x42100820000ULL,
-                0xc000004000800080ULL,
-                0x100002000400106ULL,
-                0x900002048a401200ULL,
-                0x201001000082100ULL,
-                0x40000042a010a00ULL,
-                0x130000409508200ULL,
-                0x800000111000408ULL,
-                0x80c000891220040ULL,
-                0x280048440122066ULL,
-                0x600004010920104ULL,
-                0x308001008020500cULL,
-                0x820000425001001ULL,
-                0x8200002c0201084ULL,
-                0x802024004209040cULL,
-                0x1060000801100204ULL,
-                0x88102100488402ULL,
+                0x18000a0b0400088ULL,
+                0x640100440002000ULL,
+                0x680088020001004ULL,
+                0x100100100040820ULL,
+                0x100040300100800ULL,
+                0x1a80210400020080ULL,
+                0x880008001002200ULL,
+                0x300030000804122ULL,
+                0x984800080400034ULL,
+                0x4002808040002000ULL,
+                0x801000200080ULL,
+                0x8002000a00201440ULL,
+                0x800800800400ULL,
+                0x2000800200040080ULL,
+                0x600c000230010804ULL,
+                0x22000042010084ULL,
+                0x818001400020ULL,
+                0x8440002008003000ULL,
+                0x220048024100280ULL,
+                0x4000090021001002ULL,
+                0x1010008000410ULL,
+                0x2808002000400ULL,
+                0x100840001080210ULL,
+                0x8722000c408411ULL,
+                0x80004040002000ULL,
+                0x4040500440002000ULL,
+                0x220010100201440ULL,
+                0x6001002100100008ULL,
+                0x1001100080204ULL,
+                0x202020080800400ULL,
+                0x1480400021001ULL,
+                0x800a084200042081ULL,
+                0x580002000400048ULL,
+                0x80400090802000ULL,
+                0x90410811002001ULL,
+                0x1080200a02004010ULL,
+                0x800400800800ULL,
+                0x4004c02008011004ULL,
+                0xc022000812000461ULL,
+                0x4008042000401ULL,
+                0x81028001c0028021ULL,
+                0x2001402010014004ULL,
+                0xa10008020008010ULL,
+                0x8101001000090020ULL,
+                0x4114080100050010ULL,
+                0x811002400090002ULL,
+                0x40021001040008ULL,
+                0x20009041120004ULL,
+                0x848219c0210200ULL,
+                0x2040018140200d80ULL,
+                0x4050861042002600ULL,
+                0xc21001000200900ULL,
+                0x102040080080280ULL,
+                0x1053000400020900ULL,
+                0x1040100882690400ULL,
+                0x7284800100004080ULL,
+                0x4202184202210082ULL,
+                0x8802840001105ULL,
+                0xc432001000813ULL,
+                0x3208410000901ULL,
+                0x8102010804102002ULL,
+                0x1000802040001ULL,
+                0x81042211100800c4ULL,
+                0x1142040082402702ULL,
         };
 
-const U64 bishopMagicNumbers[64] =
+constexpr U64 bishopMagicNumbers[64] =
         {
                 0x2020448008100ULL,
                 0x1820843102002050ULL,
@@ -311,7 +462,7 @@ const U64 bishopMagicNumbers[64] =
         };
 
 // generate pawn attacks
-U64 maskPawnAttacks(int sideToMove, int square) {
+constexpr U64 maskPawnAttacks(int sideToMove, int square) {
     //define piece bitboard
     U64 bitboard = 0ULL;
     // define result attacks bitboard
@@ -338,7 +489,7 @@ U64 maskPawnAttacks(int sideToMove, int square) {
 
 
 // generate knight attacks
-U64 maskKnightAttacks(int square) {
+constexpr U64 maskKnightAttacks(int square) {
     // init empty bitboard
     U64 bitboard = 0ULL;
     // init attack table
@@ -359,7 +510,7 @@ U64 maskKnightAttacks(int square) {
     return attacks;
 }
 
-U64 maskKingAttacks(int square) {
+constexpr U64 maskKingAttacks(int square) {
     // init empty bitboard
     U64 bitboard = 0ULL;
     // init attack table
@@ -386,7 +537,7 @@ U64 maskKingAttacks(int square) {
 }
 
 // mask bishop attacks for magic bitboard
-U64 maskBishopAttacks(int square) {
+constexpr U64 maskBishopAttacks(int square) {
     // init empty bitboard
     U64 bitboard = 0ULL;
 
@@ -394,7 +545,7 @@ U64 maskBishopAttacks(int square) {
     U64 attacks = 0ULL;
 
     // init ranks, files
-    int rank, file;
+    int rank = 0, file = 0;
 
     // init target ranks and files
     int targetRank = square / 8;
@@ -418,7 +569,7 @@ U64 maskBishopAttacks(int square) {
 }
 
 // mask rook attacks for magic bitboard
-U64 maskRookAttacks(int square) {
+constexpr U64 maskRookAttacks(int square) {
     // init empty bitboard
     U64 bitboard = 0ULL;
 
@@ -426,7 +577,7 @@ U64 maskRookAttacks(int square) {
     U64 attacks = 0ULL;
 
     // init ranks, files
-    int rank, file;
+    int rank = 0, file = 0;
 
     // init target ranks and files
     int targetRank = square / 8;
@@ -450,7 +601,7 @@ U64 maskRookAttacks(int square) {
 }
 
 // generate bishop attacks
-U64 generateBishopAttacks(int square, U64 block) {
+constexpr U64 generateBishopAttacks(int square, U64 block) {
     // init empty bitboard
     U64 bitboard = 0ULL;
 
@@ -458,7 +609,7 @@ U64 generateBishopAttacks(int square, U64 block) {
     U64 attacks = 0ULL;
 
     // init ranks, files
-    int rank, file;
+    int rank = 0, file = 0;
 
     // init target ranks and files
     int targetRank = square / 8;
@@ -486,7 +637,7 @@ U64 generateBishopAttacks(int square, U64 block) {
 }
 
 // generate rook attacks on the fly
-U64 generateRookAttacks(int square, U64 block) {
+constexpr U64 generateRookAttacks(int square, U64 block) {
     // init empty bitboard
     U64 bitboard = 0ULL;
 
@@ -494,26 +645,26 @@ U64 generateRookAttacks(int square, U64 block) {
     U64 attacks = 0ULL;
 
     // init ranks, files
-    int rank, file;
+    int rank = 0, file = 0;
 
     // init target ranks and files
     int targetRank = square / 8;
     int targetFile = square % 8;
 
-    // mask relevant rook occupancy bits
-    for (rank = targetRank + 1; rank <= 6; rank++) {
+    // generate rook attacks up to (and including) the first blocker
+    for (rank = targetRank + 1; rank <= 7; rank++) {
         attacks |= (1ULL << (rank * 8 + targetFile));
         if ((1ULL << (rank * 8 + targetFile)) & block) { break; }
     }
-    for (rank = targetRank - 1; rank >= 1; rank--) {
+    for (rank = targetRank - 1; rank >= 0; rank--) {
         attacks |= (1ULL << (rank * 8 + targetFile));
         if ((1ULL << (rank * 8 + targetFile)) & block) { break; }
     }
-    for (file = targetFile + 1; file <= 6; file++) {
+    for (file = targetFile + 1; file <= 7; file++) {
         attacks |= (1ULL << (targetRank * 8 + file));
         if ((1ULL << (targetRank * 8 + file)) & block) { break; }
     }
-    for (file = targetFile - 1; file >= 1; file--) {
+    for (file = targetFile - 1; file >= 0; file--) {
         attacks |= (1ULL << (targetRank * 8 + file));
         if ((1ULL << (targetRank * 8 + file)) & block) { break; }
     }
@@ -522,28 +673,48 @@ U64 generateRookAttacks(int square, U64 block) {
 }
 
 
-// initialize leaper pieces (pawns and knights)
-void init_leaper_attacks() {
+// leaper pieces attack tables
+struct LeaperAttacks {
+    U64 pawnAttacks[2][64];
+    U64 knightAttacks[64];
+    U64 kingAttacks[64];
+};
+
+// initialize leaper pieces (pawns, knights and kings)
+constexpr LeaperAttacks init_leaper_attacks() {
+    LeaperAttacks tables{};
+
     for (int square = 0; square < 64; square++) {
-        pawnAttacks[white][square] = maskPawnAttacks(white, square);
-        pawnAttacks[black][square] = maskPawnAttacks(black, square);
+        tables.pawnAttacks[white][square] = maskPawnAttacks(white, square);
+        tables.pawnAttacks[black][square] = maskPawnAttacks(black, square);
 
-        knightAttacks[square] = maskKnightAttacks(square);
-        kingAttacks[square] = maskKingAttacks(square);
+        tables.knightAttacks[square] = maskKnightAttacks(square);
+        tables.kingAttacks[square] = maskKingAttacks(square);
     }
+
+    return tables;
 }
 
-U64 setOccupancy(int index, int bitsInMask, U64 attackMask) {
+// leaper attack tables, generated at compile time
+constexpr LeaperAttacks leaperAttacks = init_leaper_attacks();
+
+// pawn attack table
+constexpr auto &pawnAttacks = leaperAttacks.pawnAttacks;
+
+// knight attack table
+constexpr auto &knightAttacks = leaperAttacks.knightAttacks;
+
+// king attack table
+constexpr auto &kingAttacks = leaperAttacks.kingAttacks;
+
+constexpr U64 setOccupancy(int index, int bitsInMask, U64 attackMask) {
     // init occupancy map
     U64 occupancy = 0ULL;
 
     // loop over range of bits in attack mask
     for (int i = 0; i < bitsInMask; i++) {
-        // get LS1B index of attack mask
-        int square = ls1bIndex(attackMask);
-
-        // pop LS1B
-        pop_bit(attackMask, square);
+        // get and pop LS1B index of attack mask
+        int square = popLs1bIndex(attackMask);
 
         // make sure occupancy is on board
         if (index & (1 << i)) {
@@ -555,59 +726,288 @@ U64 setOccupancy(int index, int bitsInMask, U64 attackMask) {
     return occupancy;
 }
 
-// initialize slider pieces attack tables (bishops and rooks)
-void init_slider_attacks(int bishop) {
-    // loop over 64 board squares
+// slider attack indexing backends
+enum {
+    magicSliders, pextSliders
+};
+
+const char *sliderBackendNames[] = {"magic", "pext"};
+
+// active slider attack indexing backend
+int sliderBackend = magicSliders;
+
+// parallel bits extract in software (table generation at compile time)
+constexpr U64 softwarePext(U64 bitboard, U64 mask) {
+    U64 result = 0ULL;
+
+    for (U64 bit = 1ULL; mask; bit <<= 1) {
+        if (bitboard & mask & -mask) result |= bit;
+        mask &= mask - 1;
+    }
+
+    return result;
+}
+
+// parallel bits extract, only called when the pext backend is active
+static inline U64 pext(U64 bitboard, U64 mask) {
+#if PEXT_SUPPORTED
+    // inline asm so no bmi2 code generation is needed for the rest of the binary
+    U64 result;
+    asm("pextq %2, %1, %0" : "=r"(result) : "r"(bitboard), "r"(mask));
+    return result;
+#else
+    // never selected by detection
+    return softwarePext(bitboard, mask);
+#endif
+}
+
+// check whether cpu supports bmi2 (reported in cpuid leaf 7, ebx bit 8)
+int cpuHasBmi2() {
+#if PEXT_SUPPORTED
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1 << 8));
+#else
+    return 0;
+#endif
+}
+
+// check whether cpu has a fast (non microcoded) pext instruction
+int cpuHasFastPext() {
+#if PEXT_SUPPORTED
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (!cpuHasBmi2()) {
+        return 0;
+    }
+
+    // AMD Zen 1/2 (family 0x17) and older run pext in microcode, magics are faster there
+    __get_cpuid(0, &eax, &ebx, &ecx, &edx);
+    int amd = ebx == 0x68747541 && edx == 0x69746e65 && ecx == 0x444d4163;
+
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    int family = (eax >> 8) & 0xF;
+    if (family == 0xF) family += (eax >> 20) & 0xFF;
+
+    return !(amd && family < 0x19);
+#else
+    return 0;
+#endif
+}
+
+// pick slider backend from cpuid, CHESS_SLIDER_BACKEND=magic|pext forces either one
+// (runs before the uci loop and batch output, so a forced backend the cpu lacks is reported on stderr)
+int selectSliderBackend() {
+    const char *forced = getenv("CHESS_SLIDER_BACKEND");
+
+    if (forced && !strcmp(forced, "magic")) {
+        return magicSliders;
+    }
+
+    if (forced && !strcmp(forced, "pext")) {
+        // pext still needs bmi2, even when forced
+        if (cpuHasBmi2()) {
+            return pextSliders;
+        }
+
+        fprintf(stderr, "pext not supported by cpu, using magic sliders\n");
+        return magicSliders;
+    }
+
+    return cpuHasFastPext() ? pextSliders : magicSliders;
+}
+
+// slider pieces attack masks
+struct SliderMasks {
+    U64 bishopMasks[64];
+    U64 rookMasks[64];
+};
+
+// initialize slider pieces relevant occupancy masks
+constexpr SliderMasks init_slider_masks() {
+    SliderMasks masks{};
+
+    for (int square = 0; square < 64; square++) {
+        masks.bishopMasks[square] = maskBishopAttacks(square);
+        masks.rookMasks[square] = maskRookAttacks(square);
+    }
+
+    return masks;
+}
+
+// slider attack masks, generated at compile time
+constexpr SliderMasks sliderMasks = init_slider_masks();
+
+// bishop attack masks
+constexpr auto &bishopMasks = sliderMasks.bishopMasks;
+
+// rook attack masks
+constexpr auto &rookMasks = sliderMasks.rookMasks;
+
+// index bits of a square slice (magic index bits may be fewer than mask bits)
+constexpr int sliderIndexBits(int backend, int piece, int square) {
+    if (backend == pextSliders) {
+        return countBits(piece == bishop ? bishopMasks[square] : rookMasks[square]);
+    }
+
+    return piece == bishop ? bishopRelevantBits[square] : rookRelevantBits[square];
+}
+
+// slider attack table size (sum of 2^indexBits over all squares of both pieces)
+constexpr int sliderTableSize(int backend) {
+    int size = 0;
+
     for (int square = 0; square < 64; square++) {
-        // init bishop and rook masks
-        bishopMasks[square] = maskBishopAttacks(square);
-        rookMasks[square]  = maskRookAttacks(square);
+        size += 1 << sliderIndexBits(backend, bishop, square);
+        size += 1 << sliderIndexBits(backend, rook, square);
+    }
+
+    return size;
+}
+
+// packed slider attacks table, every square owns a slice of 2^indexBits entries
+// (bishop slices first, rook slices after them)
+template <int tableSize>
+struct SliderAttacks {
+    // offset of every square's slice inside the attacks table
+    int bishopOffsets[64];
+    int rookOffsets[64];
 
-        // init current mask
-        U64 attackMask = bishop ? bishopMasks[square] : rookMasks[square];
+    U64 attacks[tableSize];
+};
 
-        // init relevant occupancy bit count
-        int relevantBits = countBits(attackMask);
+// initialize slider pieces attack table (bishops and rooks) for an indexing backend
+template <int tableSize>
+constexpr SliderAttacks<tableSize> init_slider_attacks(int backend) {
+    SliderAttacks<tableSize> table{};
 
-        // init occupancy indices
-        int occupancyIndices = (1 << relevantBits);
+    // bishop slices start at the beginning of the table, rook slices after them
+    int offset = 0;
 
-        // loop over occupancy indices
+    for (int piece = bishop; piece <= rook; piece++) {
+        // loop over 64 board squares
+        for (int square = 0; square < 64; square++) {
+            // init current mask, magic number and relevant occupancy bit count
+            U64 attackMask = piece == bishop ? bishopMasks[square] : rookMasks[square];
+            U64 magicNumber = piece == bishop ? bishopMagicNumbers[square] : rookMagicNumbers[square];
+            int relevantBits = sliderIndexBits(backend, piece, square);
 
-        for (int i = 0; i < occupancyIndices; i++) {
-            U64 occupancy = setOccupancy(i, relevantBits, attackMask);
-            if (bishop) {
-                // init magic index
-                int magicIndex = (occupancy * bishopMagicNumbers[square]) >> (64 - bishopRelevantBits[square]);
-                bishopAttacks[square][magicIndex] = generateBishopAttacks(square, occupancy);
+            // init offset of current square slice
+            if (piece == bishop) {
+                table.bishopOffsets[square] = offset;
             }
             else {
-                // init magic index
-                int magicIndex = (occupancy * rookMagicNumbers[square]) >> (64 - rookRelevantBits[square]);
-                rookAttacks[square][magicIndex] = generateRookAttacks(square, occupancy);
-
+                table.rookOffsets[square] = offset;
             }
+
+            // loop over every subset of the attack mask (carry-rippler)
+            U64 occupancy = 0ULL;
+            do {
+                // init magic (or pext) index
+                int index = backend == pextSliders
+                            ? (int) softwarePext(occupancy, attackMask)
+                            : (int) ((occupancy * magicNumber) >> (64 - relevantBits));
+
+                table.attacks[offset + index] = piece == bishop ? generateBishopAttacks(square, occupancy)
+                                                                : generateRookAttacks(square, occupancy);
+
+                occupancy = (occupancy - attackMask) & attackMask;
+            } while (occupancy);
+
+            offset += 1 << relevantBits;
         }
     }
+
+    return table;
 }
 
+// slider attack tables for both indexing backends, generated at compile time
+constexpr auto magicSliderAttacks = init_slider_attacks<sliderTableSize(magicSliders)>(magicSliders);
+constexpr auto pextSliderAttacks = init_slider_attacks<sliderTableSize(pextSliders)>(pextSliders);
+
 // get bishop attacks
 static inline U64 getBishopAttacks(int square, U64 occupancy) {
+    // pext index needs no magic numbers
+    if (sliderBackend == pextSliders) {
+        return pextSliderAttacks.attacks[pextSliderAttacks.bishopOffsets[square] + pext(occupancy, bishopMasks[square])];
+    }
+
     // assuming current board occupancy
     occupancy &= bishopMasks[square];
     occupancy *= bishopMagicNumbers[square];
     occupancy >>= 64 - bishopRelevantBits[square];
 
-    return bishopAttacks[square][occupancy];
+    return magicSliderAttacks.attacks[magicSliderAttacks.bishopOffsets[square] + occupancy];
 }
 // get rook attacks
 static inline U64 getRookAttacks(int square, U64 occupancy) {
+    // pext index needs no magic numbers
+    if (sliderBackend == pextSliders) {
+        return pextSliderAttacks.attacks[pextSliderAttacks.rookOffsets[square] + pext(occupancy, rookMasks[square])];
+    }
+
     occupancy &= rookMasks[square];
     occupancy *= rookMagicNumbers[square];
     occupancy >>= 64 - rookRelevantBits[square];
 
-    return rookAttacks[square][occupancy];
+    return magicSliderAttacks.attacks[magicSliderAttacks.rookOffsets[square] + occupancy];
+}
+
+// get queen attacks
+static inline U64 getQueenAttacks(int square, U64 occupancy) {
+    return getBishopAttacks(square, occupancy) | getRookAttacks(square, occupancy);
+}
+
+// squares between and lines through every pair of aligned squares
+struct LineTables {
+    // squares strictly between two squares (0 if not on a common rank, file or diagonal)
+    U64 between[64][64];
+
+    // full line through two squares, including both of them (0 if not aligned)
+    U64 line[64][64];
+};
+
+// initialize between and line tables
+constexpr LineTables init_line_tables() {
+    LineTables tables{};
+
+    for (int source = 0; source < 64; source++) {
+        for (int target = 0; target < 64; target++) {
+            U64 sourceBitboard = 1ULL << source;
+            U64 targetBitboard = 1ULL << target;
+
+            if (source == target) {
+                continue;
+            }
+
+            // same rank or file
+            if (generateRookAttacks(source, 0ULL) & targetBitboard) {
+                tables.between[source][target] = generateRookAttacks(source, targetBitboard) &
+                                                 generateRookAttacks(target, sourceBitboard);
+                tables.line[source][target] = (generateRookAttacks(source, 0ULL) &
+                                               generateRookAttacks(target, 0ULL)) | sourceBitboard | targetBitboard;
+            }
+                // same diagonal
+            else if (generateBishopAttacks(source, 0ULL) & targetBitboard) {
+                tables.between[source][target] = generateBishopAttacks(source, targetBitboard) &
+                                                 generateBishopAttacks(target, sourceBitboard);
+                tables.line[source][target] = (generateBishopAttacks(source, 0ULL) &
+                                               generateBishopAttacks(target, 0ULL)) | sourceBitboard | targetBitboard;
+            }
+        }
+    }
+
+    return tables;
 }
+
+// line tables, generated at compile time
+constexpr LineTables lineTables = init_line_tables();
+
+// squares between table[source][target]
+constexpr auto &betweenSquares = lineTables.between;
+
+// line through squares table[source][target]
+constexpr auto &lineSquares = lineTables.line;
+
 /*********************\
  ======================
   Random Number Logic
@@ -617,35 +1017,44 @@ static inline U64 getRookAttacks(int square, U64 occupancy) {
 // pseudo-random number randomState
 unsigned int randomState = 1804289383;
 
-// generate 32 bit pseudo legal numbers
-unsigned int getRandomU32Number() {
-    // get current randomState
-    unsigned int num = randomState;
+// generate 32 bit pseudo legal numbers from a random state
+constexpr unsigned int getRandomU32Number(unsigned int &state) {
+    // get current state
+    unsigned int num = state;
 
     // XOR shift 32 algorithm
     num ^= num << 13;
     num ^= num >> 17;
     num ^= num << 5;
 
-    // update random number randomState
-    randomState = num;
+    // update random number state
+    state = num;
 
     // return random number
     return num;
 }
 
-U64 getRandomU64Numbers() {
-    U64 n1, n2, n3, n4;
+// generate 32 bit pseudo legal numbers
+unsigned int getRandomU32Number() {
+    return getRandomU32Number(randomState);
+}
 
-    n1 = (U64) (getRandomU32Number()) & 0xFFFF; // slice upper from MSB side
-    n2 = (U64) (getRandomU32Number()) & 0xFFFF;
-    n3 = (U64) (getRandomU32Number()) & 0xFFFF;
-    n4 = (U64) (getRandomU32Number()) & 0xFFFF;
+constexpr U64 getRandomU64Numbers(unsigned int &state) {
+    U64 n1 = 0, n2 = 0, n3 = 0, n4 = 0;
+
+    n1 = (U64) (getRandomU32Number(state)) & 0xFFFF; // slice upper from MSB side
+    n2 = (U64) (getRandomU32Number(state)) & 0xFFFF;
+    n3 = (U64) (getRandomU32Number(state)) & 0xFFFF;
+    n4 = (U64) (getRandomU32Number(state)) & 0xFFFF;
 
     // return random u64 number
     return (n1 | (n2 << 16) | (n3 << 32) | (n4 << 48));
 }
 
+U64 getRandomU64Numbers() {
+    return getRandomU64Numbers(randomState);
+}
+
 /*********************\
  ======================
    Magic Number Logic
@@ -653,59 +1062,66 @@ U64 getRandomU64Numbers() {
 \*********************/
 
 // generate magic number candidate
-U64 generateMagicNumberCandidate() {
-    return getRandomU64Numbers() & getRandomU64Numbers() & getRandomU64Numbers();
+U64 generateMagicNumberCandidate(unsigned int &state) {
+    return getRandomU64Numbers(state) & getRandomU64Numbers(state) & getRandomU64Numbers(state);
 }
 
-U64 findMagicNumber(int square, int relevantBits, int bishop) {
+// find magic number mapping every occupancy of the square mask into 2^indexBits entries
+// (fewer index bits than mask bits only work through constructive collisions)
+U64 findMagicNumber(int square, int indexBits, int piece, unsigned int &state = randomState,
+                    long long maxTries = 100000000, long long *triesUsed = nullptr) {
     // init occupancies
     U64 occupancies[4096];
 
     // init attack tables
     U64 attacks[4096];
 
-    // init used attacks
+    // init used attacks and the try they were set in (saves clearing them every try)
     U64 usedAttacks[4096];
+    long long usedTry[4096];
 
     // init attack mask for current piece
-    U64 attackMask = bishop ? maskBishopAttacks(square) : maskRookAttacks(square);
+    U64 attackMask = piece == bishop ? maskBishopAttacks(square) : maskRookAttacks(square);
 
     // init occupancy indices
-    int occupancyIndices = 1 << relevantBits;
+    int maskBits = countBits(attackMask);
+    int occupancyIndices = 1 << maskBits;
 
     // iterate over occupancy indices
     for (int i = 0; i < occupancyIndices; i++) {
         // init occupancies
-        occupancies[i] = setOccupancy(i, relevantBits, attackMask);
+        occupancies[i] = setOccupancy(i, maskBits, attackMask);
 
         // init attacks
-        attacks[i] = bishop ? generateBishopAttacks(square, occupancies[i]) : generateRookAttacks(square,
-                                                                                                  occupancies[i]);
+        attacks[i] = piece == bishop ? generateBishopAttacks(square, occupancies[i])
+                                     : generateRookAttacks(square, occupancies[i]);
+    }
+
+    for (int i = 0; i < (1 << indexBits); i++) {
+        usedTry[i] = -1;
     }
 
     // test magic numbers
-    for (int randomCount = 0; randomCount < 1e8; randomCount++) {
+    for (long long randomCount = 0; randomCount < maxTries; randomCount++) {
         // generate magic number candidate
-        U64 magicNumber = generateMagicNumberCandidate();
+        U64 magicNumber = generateMagicNumberCandidate(state);
 
         // skip inappropriate magic nums
         if (countBits(((attackMask) * magicNumber) & 0xFF00000000000000) < 6) {
             continue;
         }
 
-        // init usedAttacks array
-        memset(usedAttacks, 0ULL, sizeof(usedAttacks));
-
         // init index and fail flag
         int index, fail;
 
         // test magic index
         for (index = 0, fail = 0; !fail && index < occupancyIndices; index++) {
-            int magicIndex = (int) (occupancies[index] * magicNumber >> (64 - relevantBits));
+            int magicIndex = (int) (occupancies[index] * magicNumber >> (64 - indexBits));
 
             // if magic index works
-            if (usedAttacks[magicIndex] == 0ULL) {
+            if (usedTry[magicIndex] != randomCount) {
                 // init usedAttacks
+                usedTry[magicIndex] = randomCount;
                 usedAttacks[magicIndex] = attacks[index];
             }
                 // magic index doesn't work
@@ -716,52 +1132,6004 @@ U64 findMagicNumber(int square, int relevantBits, int bishop) {
 
         // if magic number works return it
         if (!fail) {
+            if (triesUsed) *triesUsed = randomCount + 1;
             return magicNumber;
         }
 
     }
     // if magic number doesn't work
-    printf("magic number fails");
+    if (triesUsed) *triesUsed = maxTries;
     return 0ULL;
 }
 
-void initMagicNumbers() {
-    // loop for 64 board squares
-    for (int square = 0; square < 64; square++) {
-        //init rook magic numbers
-        printf(" 0x%llxULL,\n", findMagicNumber(square, rookRelevantBits[square], rook));
+// derive an independent, reproducible random state for every (piece, square) search
+unsigned int magicSearchState(unsigned int seed, int square, int piece) {
+    // splitmix64 finalizer over seed and job
+    U64 z = seed + 0x9E3779B97F4A7C15ULL * (U64) ((piece == bishop) * 64 + square + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+
+    // xorshift state must never be zero
+    return (unsigned int) z ? (unsigned int) z : randomState;
+}
+
+// magic number search result of one square
+struct MagicSearchResult {
+    U64 magicNumber;
+    int indexBits;
+    long long tries;
+    double milliseconds;
+};
+
+// print magic search results (rook results first, then bishop) as ready to include tables
+void printMagicTables(MagicSearchResult results[2][64]) {
+    const char *pieceNames[] = {"rook", "bishop"};
+
+    for (int slider = 0; slider < 2; slider++) {
+        printf("constexpr int %sRelevantBits[64] = {\n", pieceNames[slider]);
+        for (int square = 0; square < 64; square++) {
+            printf("%s%d,%s", square % 8 ? " " : "        ", results[slider][square].indexBits,
+                   square % 8 == 7 ? "\n" : "");
+        }
+        printf("};\n\n");
     }
-    printf("\n-------------------------------\n");
-    for (int square = 0; square < 64; square++) {
-        //init bishop magic numbers
-        printf(" 0x%llxULL,\n", findMagicNumber(square, bishopRelevantBits[square], bishop));
+
+    for (int slider = 0; slider < 2; slider++) {
+        printf("constexpr U64 %sMagicNumbers[64] =\n        {\n", pieceNames[slider]);
+        for (int square = 0; square < 64; square++) {
+            printf("                0x%llxULL,\n", results[slider][square].magicNumber);
+        }
+        printf("        };\n\n");
     }
 }
 
-void init_all() {
-    init_leaper_attacks();
-    init_slider_attacks(bishop);
-    init_slider_attacks(rook);
+// search magic numbers for all squares on multiple threads
+// (every square uses its own random stream, so results don't depend on thread count)
+void initMagicNumbers(int threadCount, int dense, unsigned int seed, long long maxTries) {
+    static MagicSearchResult results[2][64];
+    std::atomic<int> nextJob(0);
+
+    long long start = getTimeNs();
+
+    // worker picks (piece, square) jobs until all are done
+    auto worker = [&]() {
+        for (int job = nextJob++; job < 128; job = nextJob++) {
+            int piece = job < 64 ? rook : bishop;
+            int square = job % 64;
+            int relevantBits = piece == bishop ? bishopRelevantBits[square] : rookRelevantBits[square];
+            unsigned int state = magicSearchState(seed, square, piece);
+
+            MagicSearchResult &result = results[piece == bishop][square];
+            long long squareStart = getTimeNs();
+            long long tries = 0;
+
+            // denser magic with one index bit less, falls back to relevant bits if none is found
+            result.magicNumber = 0ULL;
+            if (dense) {
+                result.indexBits = relevantBits - 1;
+                result.magicNumber = findMagicNumber(square, result.indexBits, piece, state, maxTries, &tries);
+                result.tries = tries;
+            }
+            else {
+                result.tries = 0;
+            }
+
+            if (!result.magicNumber) {
+                result.indexBits = relevantBits;
+                result.magicNumber = findMagicNumber(square, result.indexBits, piece, state, maxTries, &tries);
+                result.tries += tries;
+            }
+
+            result.milliseconds = (getTimeNs() - squareStart) / 1e6;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    double elapsed = (getTimeNs() - start) / 1e6;
+
+    // report goes to stderr, stdout only gets the tables
+    int tableSize = 0, currentSize = 0, failed = 0;
+    for (int piece : {rook, bishop}) {
+        for (int square = 0; square < 64; square++) {
+            MagicSearchResult &result = results[piece == bishop][square];
+            int relevantBits = piece == bishop ? bishopRelevantBits[square] : rookRelevantBits[square];
+
+            fprintf(stderr, "  %-6s %s  bits %2d -> %2d  tries %10lld  %9.2f ms%s\n",
+                    piece == bishop ? "bishop" : "rook", squareToCoordinates[square], relevantBits, result.indexBits,
+                    result.tries, result.milliseconds, result.magicNumber ? "" : "  FAILED");
+
+            tableSize += 1 << result.indexBits;
+            currentSize += 1 << relevantBits;
+            failed += !result.magicNumber;
+        }
+    }
+
+    fprintf(stderr, "\n  threads:     %d\n", threadCount);
+    fprintf(stderr, "  seed:        %u\n", seed);
+    fprintf(stderr, "  time:        %.2f ms\n", elapsed);
+    fprintf(stderr, "  table size:  %d entries, %d KB (current %d KB)\n",
+            tableSize, tableSize * 8 / 1024, currentSize * 8 / 1024);
+    if (failed) {
+        fprintf(stderr, "  failed:      %d squares, raise tries\n", failed);
+    }
+
+    printMagicTables(results);
 }
 
 /*********************\
  ======================
-      Main Driver
+      Zobrist Keys
  ======================
 \*********************/
 
-int main() {
-    // init all variables
-    init_all();
+// seed of the zobrist key random number stream
+#define ZOBRIST_SEED 1804289383
 
-    U64 occupancy = 0ULL;
-    set_bit(occupancy, c5);
-    set_bit(occupancy, d3);
+// random keys hashing every position item
+struct ZobristKeys {
+    // piece keys [piece][square]
+    U64 pieces[12][64];
+
+    // en passant keys [file]
+    U64 enPassant[8];
+
+    // castling keys [castling rights]
+    U64 castling[16];
+
+    // side to move key (hashed when black is to move)
+    U64 side;
+};
+
+// init zobrist keys from the seeded xorshift stream
+constexpr ZobristKeys init_zobrist_keys() {
+    ZobristKeys keys{};
+    unsigned int state = ZOBRIST_SEED;
+
+    for (int piece = 0; piece < 12; piece++) {
+        for (int square = 0; square < 64; square++) {
+            keys.pieces[piece][square] = getRandomU64Numbers(state);
+        }
+    }
+
+    for (int file = 0; file < 8; file++) {
+        keys.enPassant[file] = getRandomU64Numbers(state);
+    }
+
+    for (int rights = 0; rights < 16; rights++) {
+        keys.castling[rights] = getRandomU64Numbers(state);
+    }
+
+    keys.side = getRandomU64Numbers(state);
+
+    return keys;
+}
+
+// zobrist keys, generated at compile time
+constexpr ZobristKeys zobristKeys = init_zobrist_keys();
+
+/*********************\
+ ======================
+     Neural Network
+ ======================
+\*********************/
+
+// HalfKP style network: every non-king piece is a feature relative to the king of a point of view,
+// feature transformer (one accumulator per point of view) -> 2 x NNUE_HIDDEN -> NNUE_L2 -> NNUE_L3 -> 1
+#define NNUE_FEATURES (64 * 10 * 64)
+#define NNUE_HIDDEN 256
+#define NNUE_L2 32
+#define NNUE_L3 32
+
+// hidden layer sums are scaled down by 2^NNUE_SHIFT, the output by NNUE_OUTPUT_SCALE to centipawns
+#define NNUE_SHIFT 6
+#define NNUE_OUTPUT_SCALE 16
+
+/*
+    network file layout (little endian, every section starts 64 byte aligned)
+
+    header          magic "CENNUE01", uint32 features, hidden, l2, l3 (must match the build), padded to 64 bytes
+    transformer     int16 biases [hidden], int16 weights [features][hidden]
+    hidden layer 1  int32 biases [l2], int8 weights [l2][2 * hidden]
+    hidden layer 2  int32 biases [l3], int8 weights [l3][l2]
+    output          int32 bias, int8 weights [l3]
+*/
+#define NNUE_MAGIC "CENNUE01"
+
+struct NnueHeader {
+    char magic[8];
+    uint32_t features, hidden, l2, l3;
+    char reserved[40];
+};
+
+// section offsets of the network file
+struct NnueLayout {
+    size_t transformerBiases, transformerWeights;
+    size_t l2Biases, l2Weights;
+    size_t l3Biases, l3Weights;
+    size_t outputBias, outputWeights;
+    size_t size;
+};
+
+constexpr size_t nnueAlign(size_t offset) {
+    return (offset + 63) & ~(size_t) 63;
+}
+
+constexpr NnueLayout nnueFileLayout() {
+    NnueLayout layout{};
+    size_t offset = sizeof(NnueHeader);
+
+    layout.transformerBiases = offset = nnueAlign(offset);
+    offset += NNUE_HIDDEN * sizeof(int16_t);
+    layout.transformerWeights = offset = nnueAlign(offset);
+    offset += (size_t) NNUE_FEATURES * NNUE_HIDDEN * sizeof(int16_t);
+    layout.l2Biases = offset = nnueAlign(offset);
+    offset += NNUE_L2 * sizeof(int32_t);
+    layout.l2Weights = offset = nnueAlign(offset);
+    offset += NNUE_L2 * 2 * NNUE_HIDDEN;
+    layout.l3Biases = offset = nnueAlign(offset);
+    offset += NNUE_L3 * sizeof(int32_t);
+    layout.l3Weights = offset = nnueAlign(offset);
+    offset += NNUE_L3 * NNUE_L2;
+    layout.outputBias = offset = nnueAlign(offset);
+    offset += sizeof(int32_t);
+    layout.outputWeights = offset = nnueAlign(offset);
+    offset += NNUE_L3;
+    layout.size = nnueAlign(offset);
+
+    return layout;
+}
+
+constexpr NnueLayout nnueLayout = nnueFileLayout();
+
+// network weights, pointing into the mapped file
+struct NnueNetwork {
+    const int16_t *transformerBiases = nullptr;
+    const int16_t *transformerWeights = nullptr;
+    const int32_t *l2Biases = nullptr;
+    const int8_t *l2Weights = nullptr;
+    const int32_t *l3Biases = nullptr;
+    const int8_t *l3Weights = nullptr;
+    const int32_t *outputBias = nullptr;
+    const int8_t *outputWeights = nullptr;
+
+    // mapped file
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+};
+
+NnueNetwork nnue;
+
+// evaluation uses the network (set once a network is loaded)
+bool nnueActive = false;
+
+// bumped on every load, accumulators and refresh caches of an older network are rebuilt
+int nnueGeneration = 0;
+
+// map whole file read only, nullptr on failure
+// (the kernel shares the pages between processes and only reads the parts the search touches)
+void *mapFile(const char *path, size_t &size) {
+#if defined(__unix__) || defined(__APPLE__)
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) return nullptr;
+
+    struct stat status;
+    void *mapping = nullptr;
+
+    if (!fstat(descriptor, &status) && status.st_size > 0) {
+        size = (size_t) status.st_size;
+        mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) mapping = nullptr;
+    }
 
-    printBitboard(occupancy);
+    close(descriptor);
+    return mapping;
+#else
+    // no mmap, read the file into 64 byte aligned memory instead
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return nullptr;
+
+    size = (size_t) file.tellg();
+    char *buffer = (char *) operator new(size, std::align_val_t(64));
+    file.seekg(0);
+    if (!file.read(buffer, (std::streamsize) size)) {
+        operator delete(buffer, std::align_val_t(64));
+        return nullptr;
+    }
+    return buffer;
+#endif
+}
+
+void unmapFile(void *mapping, size_t size) {
+#if defined(__unix__) || defined(__APPLE__)
+    munmap(mapping, size);
+#else
+    (void) size;
+    operator delete(mapping, std::align_val_t(64));
+#endif
+}
+
+// map network file, the current network stays active if the file can't be used
+bool loadNetwork(const char *path) {
+    size_t size = 0;
+    void *mapping = mapFile(path, size);
+    if (!mapping) return false;
+
+    const NnueHeader *header = (const NnueHeader *) mapping;
+
+    if (size != nnueLayout.size || memcmp(header->magic, NNUE_MAGIC, 8) || header->features != NNUE_FEATURES ||
+        header->hidden != NNUE_HIDDEN || header->l2 != NNUE_L2 || header->l3 != NNUE_L3) {
+        unmapFile(mapping, size);
+        return false;
+    }
+
+    // release previous network
+    if (nnue.mapping) unmapFile(nnue.mapping, nnue.mappingSize);
+
+    const char *base = (const char *) mapping;
+    nnue.transformerBiases = (const int16_t *) (base + nnueLayout.transformerBiases);
+    nnue.transformerWeights = (const int16_t *) (base + nnueLayout.transformerWeights);
+    nnue.l2Biases = (const int32_t *) (base + nnueLayout.l2Biases);
+    nnue.l2Weights = (const int8_t *) (base + nnueLayout.l2Weights);
+    nnue.l3Biases = (const int32_t *) (base + nnueLayout.l3Biases);
+    nnue.l3Weights = (const int8_t *) (base + nnueLayout.l3Weights);
+    nnue.outputBias = (const int32_t *) (base + nnueLayout.outputBias);
+    nnue.outputWeights = (const int8_t *) (base + nnueLayout.outputWeights);
+    nnue.mapping = mapping;
+    nnue.mappingSize = size;
+
+    nnueGeneration++;
+    nnueActive = true;
+    return true;
+}
+
+// back to the handcrafted evaluation
+void unloadNetwork() {
+    nnueActive = false;
+
+    if (nnue.mapping) unmapFile(nnue.mapping, nnue.mappingSize);
+    nnue = NnueNetwork();
+}
+
+// pending accumulator changes before the position is refreshed instead
+#define NNUE_MAX_CHANGES 32
+
+// feature transformer outputs of both points of view, updated lazily: make/unmake queue the piece changes
+// (a change and its inverse cancel out, so unmake mostly just drops what make queued) and evaluation applies them,
+// a king move refreshes its point of view from the refresh cache
+struct NnueAccumulator {
+    alignas(64) int16_t values[2][NNUE_HIDDEN];
+
+    // king squares the values were computed for (-1 = stale) and network generation
+    int kingSquare[2];
+    int generation;
+
+    // queued changes: colored piece * 64 + square + 1, negated for removals
+    int changes[NNUE_MAX_CHANGES];
+    int changeCount;
+
+    // values are recomputed on the next evaluation
+    void reset() {
+        kingSquare[0] = kingSquare[1] = -1;
+        changeCount = 0;
+    }
+
+    void change(int piece, int square, bool add) {
+        int change = add ? piece * 64 + square + 1 : -(piece * 64 + square + 1);
+
+        for (int i = changeCount - 1; i >= 0; i--) {
+            if (changes[i] == -change) {
+                changes[i] = changes[--changeCount];
+                return;
+            }
+        }
+
+        // long runs without evaluation (perft, tree walks) end up refreshing
+        if (changeCount == NNUE_MAX_CHANGES) {
+            reset();
+            return;
+        }
+
+        changes[changeCount++] = change;
+    }
+};
+
+// add (and subtract) the transformer weights of features to accumulator values, scalar
+void nnueUpdateScalar(int16_t *values, const int *added, int addCount, const int *removed, int removeCount) {
+    for (int i = 0; i < addCount; i++) {
+        const int16_t *weights = nnue.transformerWeights + (size_t) added[i] * NNUE_HIDDEN;
+        for (int j = 0; j < NNUE_HIDDEN; j++) values[j] = (int16_t) (values[j] + weights[j]);
+    }
+
+    for (int i = 0; i < removeCount; i++) {
+        const int16_t *weights = nnue.transformerWeights + (size_t) removed[i] * NNUE_HIDDEN;
+        for (int j = 0; j < NNUE_HIDDEN; j++) values[j] = (int16_t) (values[j] - weights[j]);
+    }
+}
+
+// clipped relu to [0, 127]
+static inline int nnueClamp(int value) {
+    return value < 0 ? 0 : value > 127 ? 127 : value;
+}
+
+// hidden and output layers of accumulator values of side to move (us) and the other side (them), scalar
+int nnuePropagateScalar(const int16_t *us, const int16_t *them) {
+    uint8_t input[2 * NNUE_HIDDEN], hidden1[NNUE_L2], hidden2[NNUE_L3];
+
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        input[i] = (uint8_t) nnueClamp(us[i]);
+        input[NNUE_HIDDEN + i] = (uint8_t) nnueClamp(them[i]);
+    }
+
+    for (int i = 0; i < NNUE_L2; i++) {
+        int sum = nnue.l2Biases[i];
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++) sum += nnue.l2Weights[i * 2 * NNUE_HIDDEN + j] * input[j];
+        hidden1[i] = (uint8_t) nnueClamp(sum >> NNUE_SHIFT);
+    }
+
+    for (int i = 0; i < NNUE_L3; i++) {
+        int sum = nnue.l3Biases[i];
+        for (int j = 0; j < NNUE_L2; j++) sum += nnue.l3Weights[i * NNUE_L2 + j] * hidden1[j];
+        hidden2[i] = (uint8_t) nnueClamp(sum >> NNUE_SHIFT);
+    }
+
+    int output = *nnue.outputBias;
+    for (int i = 0; i < NNUE_L3; i++) output += nnue.outputWeights[i] * hidden2[i];
+
+    return output;
+}
+
+#if AVX2_SUPPORTED
+// add and subtract feature weights, avx2 (128 values per pass stay in registers, loops unrolled so
+// gcc keeps them out of memory)
+__attribute__((target("avx2")))
+void nnueUpdateAvx2(int16_t *values, const int *added, int addCount, const int *removed, int removeCount) {
+    for (int offset = 0; offset < NNUE_HIDDEN; offset += 128) {
+        __m256i sums[8];
+#pragma GCC unroll 8
+        for (int j = 0; j < 8; j++) sums[j] = _mm256_load_si256((const __m256i *) (values + offset) + j);
+
+        for (int i = 0; i < addCount; i++) {
+            const __m256i *weights = (const __m256i *) (nnue.transformerWeights + (size_t) added[i] * NNUE_HIDDEN +
+                                                        offset);
+#pragma GCC unroll 8
+            for (int j = 0; j < 8; j++) sums[j] = _mm256_add_epi16(sums[j], _mm256_loadu_si256(weights + j));
+        }
+
+        for (int i = 0; i < removeCount; i++) {
+            const __m256i *weights = (const __m256i *) (nnue.transformerWeights + (size_t) removed[i] * NNUE_HIDDEN +
+                                                        offset);
+#pragma GCC unroll 8
+            for (int j = 0; j < 8; j++) sums[j] = _mm256_sub_epi16(sums[j], _mm256_loadu_si256(weights + j));
+        }
+
+#pragma GCC unroll 8
+        for (int j = 0; j < 8; j++) _mm256_store_si256((__m256i *) (values + offset) + j, sums[j]);
+    }
+}
+
+// dense layer with clipped relu: output = clamp((biases + weights * input) >> NNUE_SHIFT, 0, 127), avx2
+// (inputCount multiple of 32, four rows share every input load; maddubs can't saturate: inputs are at most 127,
+// so a pair of products stays within +-32512)
+__attribute__((target("avx2")))
+static inline void nnueAffineAvx2(const uint8_t *input, int inputCount, const int8_t *weights,
+                                  const int32_t *biases, int outputCount, uint8_t *output) {
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    for (int row = 0; row < outputCount; row += 4) {
+        const int8_t *row0 = weights + row * inputCount;
+        const int8_t *row1 = row0 + inputCount;
+        const int8_t *row2 = row1 + inputCount;
+        const int8_t *row3 = row2 + inputCount;
+        __m256i sum0 = _mm256_setzero_si256(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+
+        for (int i = 0; i < inputCount; i += 32) {
+            __m256i in = _mm256_load_si256((const __m256i *) (input + i));
+
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(
+                    _mm256_maddubs_epi16(in, _mm256_loadu_si256((const __m256i *) (row0 + i))), ones));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(
+                    _mm256_maddubs_epi16(in, _mm256_loadu_si256((const __m256i *) (row1 + i))), ones));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(
+                    _mm256_maddubs_epi16(in, _mm256_loadu_si256((const __m256i *) (row2 + i))), ones));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(
+                    _mm256_maddubs_epi16(in, _mm256_loadu_si256((const __m256i *) (row3 + i))), ones));
+        }
+
+        // horizontal sums of the four rows in one vector
+        __m256i pairs = _mm256_hadd_epi32(_mm256_hadd_epi32(sum0, sum1), _mm256_hadd_epi32(sum2, sum3));
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(pairs), _mm256_extracti128_si256(pairs, 1));
+        total = _mm_srai_epi32(_mm_add_epi32(total, _mm_loadu_si128((const __m128i *) (biases + row))), NNUE_SHIFT);
+
+        // saturating packs clamp to [0, 127] together with the max
+        __m128i packed = _mm_packs_epi16(_mm_packs_epi32(total, total), _mm_setzero_si128());
+        packed = _mm_max_epi8(packed, _mm_setzero_si128());
+        int clamped = _mm_cvtsi128_si32(packed);
+        memcpy(output + row, &clamped, 4);
+    }
+}
+
+// hidden and output layers, avx2 (same integer arithmetic as the scalar kernel, results are identical)
+__attribute__((target("avx2")))
+int nnuePropagateAvx2(const int16_t *us, const int16_t *them) {
+    alignas(32) uint8_t input[2 * NNUE_HIDDEN];
+    alignas(32) uint8_t hidden1[NNUE_L2];
+    alignas(32) uint8_t hidden2[NNUE_L3];
+    const __m256i zero = _mm256_setzero_si256();
+
+    // clipped relu: packs saturates to [-128, 127] and interleaves the 128 bit lanes, the permute restores the order
+    for (int side = 0; side < 2; side++) {
+        const int16_t *values = side ? them : us;
+
+        for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+            __m256i packed = _mm256_packs_epi16(_mm256_load_si256((const __m256i *) (values + i)),
+                                                _mm256_load_si256((const __m256i *) (values + i + 16)));
+            packed = _mm256_permute4x64_epi64(_mm256_max_epi8(packed, zero), 0xd8);
+            _mm256_store_si256((__m256i *) (input + side * NNUE_HIDDEN + i), packed);
+        }
+    }
+
+    nnueAffineAvx2(input, 2 * NNUE_HIDDEN, nnue.l2Weights, nnue.l2Biases, NNUE_L2, hidden1);
+    nnueAffineAvx2(hidden1, NNUE_L2, nnue.l3Weights, nnue.l3Biases, NNUE_L3, hidden2);
+
+    // output neuron
+    const int8_t *outputWeights = nnue.outputWeights;
+    int output = *nnue.outputBias;
+    for (int i = 0; i < NNUE_L3; i++) output += outputWeights[i] * hidden2[i];
+
+    return output;
+}
+#endif
+
+// network kernel backends
+enum {scalarNnue, avx2Nnue};
+
+const char *nnueBackendNames[] = {"scalar", "avx2"};
+
+typedef void (*NnueUpdateKernel)(int16_t *values, const int *added, int addCount, const int *removed,
+                                 int removeCount);
+typedef int (*NnuePropagateKernel)(const int16_t *us, const int16_t *them);
+
+// active network backend and kernels
+int nnueBackend = scalarNnue;
+NnueUpdateKernel nnueUpdate = nnueUpdateScalar;
+NnuePropagateKernel nnuePropagate = nnuePropagateScalar;
+
+void setNnueBackend(int backend) {
+    nnueBackend = backend;
+    nnueUpdate = nnueUpdateScalar;
+    nnuePropagate = nnuePropagateScalar;
+
+#if AVX2_SUPPORTED
+    if (backend == avx2Nnue) {
+        nnueUpdate = nnueUpdateAvx2;
+        nnuePropagate = nnuePropagateAvx2;
+    }
+#endif
+}
+
+// load network named on the command line and report which one is used (on stderr, stdout may carry batch results)
+bool loadNetworkArgument(const char *path) {
+    if (!loadNetwork(path)) {
+        fprintf(stderr, "cannot load network %s\n", path);
+        return false;
+    }
+
+    fprintf(stderr, "network %s loaded (%s kernels)\n", path, nnueBackendNames[nnueBackend]);
+    return true;
+}
+
+/*********************\
+ ======================
+  Board Representation
+ ======================
+\*********************/
+
+// move type
+typedef unsigned short Move;
+
+// empty move
+#define NO_MOVE 0
+
+// maximum number of plies a game (plus search) can take
+#define MAX_GAME_PLY 2048
+
+// move flags (4 bits)
+enum {
+    quietMove, doublePawnPush, kingCastle, queenCastle,
+    captureMove, enPassantCapture,
+    knightPromotion = 8, bishopPromotion, rookPromotion, queenPromotion,
+    knightPromotionCapture, bishopPromotionCapture, rookPromotionCapture, queenPromotionCapture
+};
+
+/*
+          binary move bits                                hexadecimal constants
+
+    0000 0000 0011 1111    source square       0x3f
+    0000 1111 1100 0000    target square       0xfc0
+    0100 0000 0000 0000    capture flag        0x4000
+    1000 0000 0000 0000    promotion flag      0x8000
+    1111 0000 0000 0000    move flags          0xf000
+*/
+
+// encode move
+#define encode_move(source, target, flags) (Move) ((source) | ((target) << 6) | ((flags) << 12))
+
+// extract move items
+#define get_move_source(move) ((move) & 0x3f)
+#define get_move_target(move) (((move) >> 6) & 0x3f)
+#define get_move_flags(move) ((move) >> 12)
+#define is_capture(move) ((move) & 0x4000)
+#define is_promotion(move) ((move) & 0x8000)
+#define get_move_promoted(move) ((((move) >> 12) & 3) + knight)
+
+// promoted piece characters in UCI move notation
+const char promotedPieces[] = "nbrq";
+
+// write move in UCI notation (e2e4, e7e8q) into str, returns str
+char *moveToString(Move move, char *str) {
+    const char *source = squareToCoordinates[get_move_source(move)];
+    const char *target = squareToCoordinates[get_move_target(move)];
+
+    str[0] = source[0];
+    str[1] = source[1];
+    str[2] = target[0];
+    str[3] = target[1];
+    str[4] = is_promotion(move) ? promotedPieces[get_move_flags(move) & 3] : '\0';
+    str[5] = '\0';
+
+    return str;
+}
+
+// castling rights binary encoding
+/*
+    bin  dec
+   0001    1  white king can castle to the king side
+   0010    2  white king can castle to the queen side
+   0100    4  black king can castle to the king side
+   1000    8  black king can castle to the queen side
+*/
+enum {
+    wk = 1, wq = 2, bk = 4, bq = 8
+};
+
+// castling rights kept when a piece moves from or to a square
+constexpr int castlingRightsMask[64] = {
+        7, 15, 15, 15, 3, 15, 15, 11,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        15, 15, 15, 15, 15, 15, 15, 15,
+        13, 15, 15, 15, 12, 15, 15, 14
+};
+
+// colored pieces on board squares (color * 6 + piece type)
+#define NO_PIECE 12
+#define make_piece(color, type) ((color) * 6 + (type))
+#define get_piece_color(piece) ((piece) / 6)
+#define get_piece_type(piece) ((piece) % 6)
+
+// ASCII pieces
+const char asciiPieces[] = "PNBRQKpnbrqk";
+
+// FEN debug positions
+#define START_POSITION "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 "
+
+// state that can't be recovered from a move when it is taken back
+struct UndoInfo {
+    int captured;
+    int castling;
+    int enPassant;
+    int halfmoveClock;
+    U64 hashKey;
+    U64 pawnKey;
+};
+
+class CBoard {
+public:
+    // piece bitboards [color][piece type]
+    U64 pieces[2][6];
+
+    // occupancy bitboards [white, black, both]
+    U64 occupancies[3];
+
+    // piece on every square (NO_PIECE if empty)
+    int mailbox[64];
+
+    // side to move
+    int side;
+
+    // en passant square (no_sq if none)
+    int enPassant;
+
+    // castling rights
+    int castling;
+
+    // move counters
+    int halfmoveClock;
+    int fullmoveNumber;
+
+    // zobrist hash key of position
+    U64 hashKey;
+
+    // zobrist hash key of pawns only (pawn hash table)
+    U64 pawnKey;
+
+    // undo stack of made moves
+    UndoInfo undoStack[MAX_GAME_PLY];
+    int undoCount;
+
+    // network accumulator (brought up to date by evaluation, hence mutable)
+    mutable NnueAccumulator accumulator;
+
+    CBoard() {
+        clear();
+    }
+
+    // reset board to empty position
+    void clear() {
+        memset(pieces, 0, sizeof(pieces));
+        memset(occupancies, 0, sizeof(occupancies));
+
+        for (int square = 0; square < 64; square++) {
+            mailbox[square] = NO_PIECE;
+        }
+
+        side = white;
+        enPassant = no_sq;
+        castling = 0;
+        halfmoveClock = 0;
+        fullmoveNumber = 1;
+        hashKey = 0ULL;
+        pawnKey = 0ULL;
+        undoCount = 0;
+        accumulator.reset();
+    }
+
+    // get square of side's king
+    int getKingSquare(int color) const {
+        return ls1bIndex(pieces[color][king]);
+    }
+
+    // FEN parse results: well formed and legal, malformed text, well formed but not a reachable position
+    enum {fenValid, fenMalformed, fenIllegal};
+
+    int readFen(const char *fen);
+    void print() const;
+
+    // parse FEN string into board, returns false on malformed input or an illegal position
+    bool parseFen(const char *fen) {
+        return readFen(fen) == fenValid;
+    }
+
+    U64 generateHashKey() const;
+    U64 generatePawnKey() const;
+
+    // has position occurred before since the last irreversible move
+    bool isRepetition() const {
+        for (int i = undoCount - 2; i >= 0 && i >= undoCount - halfmoveClock; i -= 2) {
+            if (undoStack[i].hashKey == hashKey) return true;
+        }
+        return false;
+    }
+
+    void makeMove(Move move);
+    void unmakeMove(Move move);
+
+private:
+    // put piece on empty square
+    template <bool updateHash = true>
+    inline void putPiece(int piece, int square) {
+        U64 bitboard = 1ULL << square;
+        int color = get_piece_color(piece);
+
+        pieces[color][get_piece_type(piece)] |= bitboard;
+        occupancies[color] |= bitboard;
+        occupancies[both] |= bitboard;
+        mailbox[square] = piece;
+
+        if (updateHash) {
+            hashKey ^= zobristKeys.pieces[piece][square];
+            if (get_piece_type(piece) == pawn) pawnKey ^= zobristKeys.pieces[piece][square];
+        }
+        if (nnueActive && get_piece_type(piece) != king) accumulator.change(piece, square, true);
+    }
+
+    // remove piece from occupied square
+    template <bool updateHash = true>
+    inline void removePiece(int square) {
+        U64 bitboard = 1ULL << square;
+        int piece = mailbox[square];
+        int color = get_piece_color(piece);
+
+        pieces[color][get_piece_type(piece)] ^= bitboard;
+        occupancies[color] ^= bitboard;
+        occupancies[both] ^= bitboard;
+        mailbox[square] = NO_PIECE;
+
+        if (updateHash) {
+            hashKey ^= zobristKeys.pieces[piece][square];
+            if (get_piece_type(piece) == pawn) pawnKey ^= zobristKeys.pieces[piece][square];
+        }
+        if (nnueActive && get_piece_type(piece) != king) accumulator.change(piece, square, false);
+    }
+
+    // move piece from occupied to empty square
+    template <bool updateHash = true>
+    inline void movePiece(int source, int target) {
+        U64 bitboard = (1ULL << source) | (1ULL << target);
+        int piece = mailbox[source];
+        int color = get_piece_color(piece);
+
+        pieces[color][get_piece_type(piece)] ^= bitboard;
+        occupancies[color] ^= bitboard;
+        occupancies[both] ^= bitboard;
+        mailbox[target] = piece;
+        mailbox[source] = NO_PIECE;
+
+        if (updateHash) {
+            U64 key = zobristKeys.pieces[piece][source] ^ zobristKeys.pieces[piece][target];
+            hashKey ^= key;
+            if (get_piece_type(piece) == pawn) pawnKey ^= key;
+        }
+
+        // kings aren't features, a king move refreshes its point of view
+        if (nnueActive && get_piece_type(piece) != king) {
+            accumulator.change(piece, source, false);
+            accumulator.change(piece, target, true);
+        }
+    }
+
+    // en passant square is only kept when a pawn of side to move can capture on it
+    inline bool enPassantCapturable(int square) const {
+        return pawnAttacks[side ^ 1][square] & pieces[side][pawn];
+    }
+
+    // can side to move capture the enemy king (the side that just moved left it in check)
+    bool enemyKingCapturable() const {
+        int square = getKingSquare(side ^ 1);
+        U64 occupancy = occupancies[both];
+
+        return (pawnAttacks[side ^ 1][square] & pieces[side][pawn]) ||
+               (knightAttacks[square] & pieces[side][knight]) ||
+               (kingAttacks[square] & pieces[side][king]) ||
+               (getBishopAttacks(square, occupancy) & (pieces[side][bishop] | pieces[side][queen])) ||
+               (getRookAttacks(square, occupancy) & (pieces[side][rook] | pieces[side][queen]));
+    }
+
+    // full hash recompute check (DEBUG_HASH builds only)
+    void verifyHashKey(const char *where) const;
+};
+
+// parse FEN string into board, rights and en passant squares the position doesn't allow are dropped
+int CBoard::readFen(const char *fen) {
+    clear();
+
+    // loop over board squares
+    int square = 0;
+    while (*fen && *fen != ' ') {
+        // piece
+        const char *piece = strchr(asciiPieces, *fen);
+        if (piece) {
+            if (square > 63) return fenMalformed;
+            putPiece((int) (piece - asciiPieces), square++);
+        }
+            // empty squares
+        else if (*fen >= '1' && *fen <= '8') {
+            square += *fen - '0';
+        }
+            // rank separator
+        else if (*fen != '/') {
+            return fenMalformed;
+        }
+
+        fen++;
+    }
+
+    if (square != 64) return fenMalformed;
+
+    // parse side to move
+    while (*fen == ' ') fen++;
+    if (*fen == 'w') side = white;
+    else if (*fen == 'b') side = black;
+    else return fenMalformed;
+    fen++;
+
+    // parse castling rights
+    while (*fen == ' ') fen++;
+    while (*fen && *fen != ' ') {
+        switch (*fen) {
+            case 'K': castling |= wk; break;
+            case 'Q': castling |= wq; break;
+            case 'k': castling |= bk; break;
+            case 'q': castling |= bq; break;
+            case '-': break;
+            default: return fenMalformed;
+        }
+        fen++;
+    }
+
+    // parse en passant square
+    while (*fen == ' ') fen++;
+    if (*fen >= 'a' && *fen <= 'h' && fen[1] >= '1' && fen[1] <= '8') {
+        int file = fen[0] - 'a';
+        int rank = 8 - (fen[1] - '0');
+        enPassant = rank * 8 + file;
+        fen += 2;
+    }
+    else if (*fen == '-') {
+        fen++;
+    }
+
+    // en passant square must be empty and on the third rank of the side that just moved, behind its pushed pawn
+    if (enPassant != no_sq) {
+        int pushed = side == white ? enPassant + 8 : enPassant - 8;
+        if (enPassant / 8 != (side == white ? 2 : 5) || mailbox[enPassant] != NO_PIECE ||
+            mailbox[pushed] != make_piece(side ^ 1, pawn)) {
+            enPassant = no_sq;
+        }
+    }
+
+    // drop en passant square nobody can capture on (keeps hash keys of equal positions equal)
+    if (enPassant != no_sq && !enPassantCapturable(enPassant)) {
+        enPassant = no_sq;
+    }
+
+    // castling rights need king and rook on their home squares
+    if (mailbox[e1] != make_piece(white, king)) castling &= ~(wk | wq);
+    if (mailbox[h1] != make_piece(white, rook)) castling &= ~wk;
+    if (mailbox[a1] != make_piece(white, rook)) castling &= ~wq;
+    if (mailbox[e8] != make_piece(black, king)) castling &= ~(bk | bq);
+    if (mailbox[h8] != make_piece(black, rook)) castling &= ~bk;
+    if (mailbox[a8] != make_piece(black, rook)) castling &= ~bq;
+
+    // parse move counters (optional in EPD)
+    while (*fen == ' ') fen++;
+    if (*fen >= '0' && *fen <= '9') {
+        halfmoveClock = (int) strtol(fen, (char **) &fen, 10);
+
+        while (*fen == ' ') fen++;
+        if (*fen >= '0' && *fen <= '9') {
+            fullmoveNumber = (int) strtol(fen, nullptr, 10);
+        }
+    }
+
+    hashKey = generateHashKey();
+    pawnKey = generatePawnKey();
+
+    // exactly one king per side, no pawns on the first or last rank, the side not to move isn't in check
+    if (countBits(pieces[white][king]) != 1 || countBits(pieces[black][king]) != 1) return fenIllegal;
+    if ((pieces[white][pawn] | pieces[black][pawn]) & 0xFF000000000000FFULL) return fenIllegal;
+    if (enemyKingCapturable()) return fenIllegal;
+
+    return fenValid;
+}
+
+// print board
+void CBoard::print() const {
+    printf("\n");
+
+    // loop over board ranks
+    for (int rank = 0; rank < 8; rank++) {
+        // loop over board files
+        for (int file = 0; file < 8; file++) {
+            int square = rank * 8 + file;
+
+            // print ranks
+            if (!file) {
+                printf("  %d ", 8 - rank);
+            }
+
+            printf(" %c", mailbox[square] == NO_PIECE ? '.' : asciiPieces[mailbox[square]]);
+        }
+        printf("\n");
+    }
+
+    // print board files
+    printf("\n     a b c d e f g h\n\n");
+
+    printf("     Side:      %s\n", side == white ? "white" : "black");
+    printf("     Enpassant: %s\n", enPassant != no_sq ? squareToCoordinates[enPassant] : "no");
+    printf("     Castling:  %c%c%c%c\n",
+           (castling & wk) ? 'K' : '-', (castling & wq) ? 'Q' : '-',
+           (castling & bk) ? 'k' : '-', (castling & bq) ? 'q' : '-');
+    printf("     Hash key:  %llx\n\n", hashKey);
+}
+
+// generate hash key of position from scratch
+U64 CBoard::generateHashKey() const {
+    U64 key = 0ULL;
+
+    for (int square = 0; square < 64; square++) {
+        if (mailbox[square] != NO_PIECE) {
+            key ^= zobristKeys.pieces[mailbox[square]][square];
+        }
+    }
+
+    if (enPassant != no_sq) {
+        key ^= zobristKeys.enPassant[enPassant % 8];
+    }
+
+    key ^= zobristKeys.castling[castling];
+
+    if (side == black) {
+        key ^= zobristKeys.side;
+    }
+
+    return key;
+}
+
+// generate pawn hash key of position from scratch
+U64 CBoard::generatePawnKey() const {
+    U64 key = 0ULL;
+
+    for (int color = white; color <= black; color++) {
+        U64 bitboard = pieces[color][pawn];
+        while (bitboard) {
+            key ^= zobristKeys.pieces[make_piece(color, pawn)][popLs1bIndex(bitboard)];
+        }
+    }
+
+    return key;
+}
+
+// compare incrementally updated hash keys against full recompute
+void CBoard::verifyHashKey(const char *where) const {
+    if (hashKey != generateHashKey()) {
+        fprintf(stderr, "hash key mismatch after %s: %llx, expected %llx\n", where, hashKey, generateHashKey());
+        abort();
+    }
+    if (pawnKey != generatePawnKey()) {
+        fprintf(stderr, "pawn key mismatch after %s: %llx, expected %llx\n", where, pawnKey, generatePawnKey());
+        abort();
+    }
+}
+
+// make (legal) move on board, updating every board item incrementally
+void CBoard::makeMove(Move move) {
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int flags = get_move_flags(move);
+
+    // save irreversible state
+    UndoInfo &undo = undoStack[undoCount++];
+    undo.captured = NO_PIECE;
+    undo.castling = castling;
+    undo.enPassant = enPassant;
+    undo.halfmoveClock = halfmoveClock;
+    undo.hashKey = hashKey;
+    undo.pawnKey = pawnKey;
+
+    // hash out old en passant square and castling rights, flip side
+    if (enPassant != no_sq) {
+        hashKey ^= zobristKeys.enPassant[enPassant % 8];
+    }
+    hashKey ^= zobristKeys.castling[castling] ^ zobristKeys.side;
+
+    halfmoveClock++;
+    enPassant = no_sq;
+
+    // remove captured piece (en passant captured pawn is behind target square)
+    if (is_capture(move)) {
+        int capturedSquare = flags == enPassantCapture ? target + (side == white ? 8 : -8) : target;
+
+        undo.captured = mailbox[capturedSquare];
+        removePiece(capturedSquare);
+        halfmoveClock = 0;
+    }
+
+    // pawn moves reset the fifty move rule counter
+    if (get_piece_type(mailbox[source]) == pawn) {
+        halfmoveClock = 0;
+    }
+
+    movePiece(source, target);
+
+    // handle special moves
+    if (is_promotion(move)) {
+        removePiece(target);
+        putPiece(make_piece(side, get_move_promoted(move)), target);
+    }
+    else if (flags == doublePawnPush) {
+        // en passant square only if an enemy pawn stands next to the target
+        if (pawnAttacks[side][target + (side == white ? 8 : -8)] & pieces[side ^ 1][pawn]) {
+            enPassant = target + (side == white ? 8 : -8);
+            hashKey ^= zobristKeys.enPassant[enPassant % 8];
+        }
+    }
+    else if (flags == kingCastle) {
+        movePiece(target + 1, target - 1);
+    }
+    else if (flags == queenCastle) {
+        movePiece(target - 2, target + 1);
+    }
+
+    // update castling rights
+    castling &= castlingRightsMask[source] & castlingRightsMask[target];
+    hashKey ^= zobristKeys.castling[castling];
+
+    if (side == black) {
+        fullmoveNumber++;
+    }
+
+    // change side
+    side ^= 1;
+
+#ifdef DEBUG_HASH
+    verifyHashKey("makeMove");
+#endif
+}
+
+// take back move made by makeMove
+void CBoard::unmakeMove(Move move) {
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int flags = get_move_flags(move);
+
+    // change side back
+    side ^= 1;
+
+    if (side == black) {
+        fullmoveNumber--;
+    }
+
+    // undo special moves (hash keys are restored from undo stack)
+    if (is_promotion(move)) {
+        removePiece<false>(target);
+        putPiece<false>(make_piece(side, pawn), target);
+    }
+    else if (flags == kingCastle) {
+        movePiece<false>(target - 1, target + 1);
+    }
+    else if (flags == queenCastle) {
+        movePiece<false>(target + 1, target - 2);
+    }
+
+    movePiece<false>(target, source);
+
+    // restore irreversible state
+    const UndoInfo &undo = undoStack[--undoCount];
+
+    if (undo.captured != NO_PIECE) {
+        putPiece<false>(undo.captured, flags == enPassantCapture ? target + (side == white ? 8 : -8) : target);
+    }
+
+    castling = undo.castling;
+    enPassant = undo.enPassant;
+    halfmoveClock = undo.halfmoveClock;
+    hashKey = undo.hashKey;
+    pawnKey = undo.pawnKey;
+
+#ifdef DEBUG_HASH
+    verifyHashKey("unmakeMove");
+#endif
+}
+
+/*********************\
+ ======================
+    Move Generation
+ ======================
+\*********************/
+
+// no position has more than 218 legal moves
+#define MAX_MOVES 256
+
+// rank bitboards
+constexpr U64 rank8 = 0x00000000000000FFULL;
+constexpr U64 rank7 = 0x000000000000FF00ULL;
+constexpr U64 rank2 = 0x00FF000000000000ULL;
+constexpr U64 rank1 = 0xFF00000000000000ULL;
+
+// fixed capacity, stack allocated move list
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count;
+};
+
+// generated move types: all moves, captures and promotions only, everything else
+enum {allMoves, tacticalMoves, quietMoves};
+
+// add move to move list
+static inline void addMove(MoveList &list, Move move) {
+    list.moves[list.count++] = move;
+}
+
+// add moves from source square to every target square, split into captures and quiets
+template <int type>
+static inline void addPieceMoves(MoveList &list, int source, U64 targets, U64 theirs) {
+    U64 captures = type != quietMoves ? targets & theirs : 0ULL;
+    U64 quiets = type != tacticalMoves ? targets & ~theirs : 0ULL;
+
+    while (captures) {
+        addMove(list, encode_move(source, popLs1bIndex(captures), captureMove));
+    }
+    while (quiets) {
+        addMove(list, encode_move(source, popLs1bIndex(quiets), quietMove));
+    }
+}
+
+// add all four promotions of a pawn move
+static inline void addPromotions(MoveList &list, int source, int target, int capture) {
+    int flags = capture ? knightPromotionCapture : knightPromotion;
+
+    addMove(list, encode_move(source, target, flags + 3));
+    addMove(list, encode_move(source, target, flags + 2));
+    addMove(list, encode_move(source, target, flags + 1));
+    addMove(list, encode_move(source, target, flags));
+}
+
+// is square attacked by given side with given occupancy
+template <int them>
+static inline bool isSquareAttacked(const CBoard &board, int square, U64 occupancy) {
+    // pawns attack square if square "attacks" them with a pawn of the other side
+    return (pawnAttacks[them ^ 1][square] & board.pieces[them][pawn]) ||
+           (knightAttacks[square] & board.pieces[them][knight]) ||
+           (kingAttacks[square] & board.pieces[them][king]) ||
+           (getBishopAttacks(square, occupancy) & (board.pieces[them][bishop] | board.pieces[them][queen])) ||
+           (getRookAttacks(square, occupancy) & (board.pieces[them][rook] | board.pieces[them][queen]));
+}
+
+// is square attacked by given side
+static inline bool isSquareAttacked(const CBoard &board, int square, int side) {
+    return side == white ? isSquareAttacked<white>(board, square, board.occupancies[both])
+                         : isSquareAttacked<black>(board, square, board.occupancies[both]);
+}
+
+// is side to move in check
+static inline bool inCheck(const CBoard &board) {
+    return isSquareAttacked(board, board.getKingSquare(board.side), board.side ^ 1);
+}
+
+// all pieces of both sides attacking square with given occupancy
+static inline U64 attackersTo(const CBoard &board, int square, U64 occupancy) {
+    const U64 diagonals = board.pieces[white][bishop] | board.pieces[black][bishop] |
+                          board.pieces[white][queen] | board.pieces[black][queen];
+    const U64 lines = board.pieces[white][rook] | board.pieces[black][rook] |
+                      board.pieces[white][queen] | board.pieces[black][queen];
+
+    return (pawnAttacks[black][square] & board.pieces[white][pawn]) |
+           (pawnAttacks[white][square] & board.pieces[black][pawn]) |
+           (knightAttacks[square] & (board.pieces[white][knight] | board.pieces[black][knight])) |
+           (kingAttacks[square] & (board.pieces[white][king] | board.pieces[black][king])) |
+           (getBishopAttacks(square, occupancy) & diagonals) |
+           (getRookAttacks(square, occupancy) & lines);
+}
+
+// piece values of static exchange evaluation [piece type]
+const int seeValue[6] = {100, 300, 300, 500, 900, 20000};
+
+// static exchange evaluation of move (material balance of the capture sequence on the target square)
+// swap list: both sides recapture with their least valuable attacker, sliders behind a removed piece
+// (x-rays) are found by recomputing slider attacks with the updated occupancy
+int see(const CBoard &board, Move move) {
+    stats_add(seeCalls, 1);
+
+    const int source = get_move_source(move);
+    const int target = get_move_target(move);
+    const U64 diagonals = board.pieces[white][bishop] | board.pieces[black][bishop] |
+                          board.pieces[white][queen] | board.pieces[black][queen];
+    const U64 lines = board.pieces[white][rook] | board.pieces[black][rook] |
+                      board.pieces[white][queen] | board.pieces[black][queen];
+
+    int gain[32];
+    int depth = 0;
+    int side = board.side;
+    int attacker = get_piece_type(board.mailbox[source]);
+
+    U64 occupancy = board.occupancies[both];
+    U64 sourceBitboard = 1ULL << source;
+
+    // material won by the move itself
+    if (get_move_flags(move) == enPassantCapture) {
+        gain[0] = seeValue[pawn];
+        occupancy ^= 1ULL << (target + (side == white ? 8 : -8));
+    }
+    else {
+        gain[0] = is_capture(move) ? seeValue[get_piece_type(board.mailbox[target])] : 0;
+    }
+
+    if (is_promotion(move)) {
+        attacker = get_move_promoted(move);
+        gain[0] += seeValue[attacker] - seeValue[pawn];
+    }
+
+    U64 attackers = attackersTo(board, target, occupancy);
+
+    do {
+        depth++;
+        side ^= 1;
+
+        // speculative gain if the piece on target is captured next
+        gain[depth] = seeValue[attacker] - gain[depth - 1];
+
+        // neither side can improve by continuing
+        if (std::max(-gain[depth - 1], gain[depth]) < 0) break;
+
+        // remove capturing piece and add x-ray attackers behind it
+        occupancy ^= sourceBitboard;
+        attackers |= (getBishopAttacks(target, occupancy) & diagonals) | (getRookAttacks(target, occupancy) & lines);
+        attackers &= occupancy;
+
+        // least valuable attacker of side to capture
+        sourceBitboard = 0ULL;
+        for (int type = pawn; type <= king; type++) {
+            U64 bitboard = attackers & board.pieces[side][type];
+            if (bitboard) {
+                sourceBitboard = bitboard & (0ULL - bitboard);
+                attacker = type;
+                break;
+            }
+        }
+    } while (sourceBitboard && depth < 31);
+
+    // negamax the swap list back to the first capture
+    while (--depth) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    }
+
+    return gain[0];
+}
+
+// generate legal moves of given type for side to move, appended to list
+// (check and pin masks are computed once, so no move has to be made to test it)
+template <int us, int type>
+void generateLegalMoves(const CBoard &board, MoveList &list) {
+    constexpr int them = us ^ 1;
+
+    // pawn push direction, promotion and double push ranks
+    constexpr int up = us == white ? -8 : 8;
+    constexpr U64 promotionRank = us == white ? rank8 : rank1;
+    constexpr U64 doublePushRank = us == white ? rank2 : rank7;
+
+    const U64 occupancy = board.occupancies[both];
+    const U64 ours = board.occupancies[us];
+    const U64 theirs = board.occupancies[them];
+    const U64 theirDiagonals = board.pieces[them][bishop] | board.pieces[them][queen];
+    const U64 theirLines = board.pieces[them][rook] | board.pieces[them][queen];
+    const int kingSquare = board.getKingSquare(us);
+
+    // target squares of the move type (tactical moves capture, quiet moves don't)
+    const U64 typeMask = type == tacticalMoves ? theirs : type == quietMoves ? ~theirs : ~0ULL;
+
+    // enemy pieces giving check
+    U64 checkers = (pawnAttacks[us][kingSquare] & board.pieces[them][pawn]) |
+                   (knightAttacks[kingSquare] & board.pieces[them][knight]) |
+                   (getBishopAttacks(kingSquare, occupancy) & theirDiagonals) |
+                   (getRookAttacks(kingSquare, occupancy) & theirLines);
+
+    // king moves (king is lifted off the board so it can't step back along a checking ray)
+    U64 occupancyWithoutKing = occupancy ^ (1ULL << kingSquare);
+    U64 kingTargets = kingAttacks[kingSquare] & ~ours & typeMask;
+
+    while (kingTargets) {
+        int target = popLs1bIndex(kingTargets);
+
+        if (!isSquareAttacked<them>(board, target, occupancyWithoutKing)) {
+            addMove(list, encode_move(kingSquare, target, get_bit(theirs, target) ? captureMove : quietMove));
+        }
+    }
+
+    // only king moves get out of double check
+    if (checkers & (checkers - 1)) {
+        return;
+    }
+
+    // target squares resolving check: capture the checker or block its ray
+    U64 checkMask = checkers ? checkers | betweenSquares[kingSquare][ls1bIndex(checkers)] : ~0ULL;
+
+    // pinned pieces: our only piece between king and an enemy slider
+    U64 pinned = 0ULL;
+    U64 snipers = (getBishopAttacks(kingSquare, theirs) & theirDiagonals) |
+                  (getRookAttacks(kingSquare, theirs) & theirLines);
+
+    while (snipers) {
+        U64 blockers = betweenSquares[kingSquare][popLs1bIndex(snipers)] & occupancy;
+
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & ours)) {
+            pinned |= blockers;
+        }
+    }
+
+    // squares our pieces may move to
+    const U64 targetMask = ~ours & checkMask;
+
+    // knight moves (pinned knights can never move)
+    U64 knights = board.pieces[us][knight] & ~pinned;
+    while (knights) {
+        int source = popLs1bIndex(knights);
+        addPieceMoves<type>(list, source, knightAttacks[source] & targetMask, theirs);
+    }
+
+    // bishop and queen diagonal moves
+    U64 diagonals = board.pieces[us][bishop] | board.pieces[us][queen];
+    while (diagonals) {
+        int source = popLs1bIndex(diagonals);
+        U64 targets = getBishopAttacks(source, occupancy) & targetMask;
+
+        if (get_bit(pinned, source)) targets &= lineSquares[kingSquare][source];
+        addPieceMoves<type>(list, source, targets, theirs);
+    }
+
+    // rook and queen straight moves
+    U64 lines = board.pieces[us][rook] | board.pieces[us][queen];
+    while (lines) {
+        int source = popLs1bIndex(lines);
+        U64 targets = getRookAttacks(source, occupancy) & targetMask;
+
+        if (get_bit(pinned, source)) targets &= lineSquares[kingSquare][source];
+        addPieceMoves<type>(list, source, targets, theirs);
+    }
+
+    // pawn moves
+    U64 pawns = board.pieces[us][pawn];
+    while (pawns) {
+        int source = popLs1bIndex(pawns);
+
+        // pinned pawns stay on the pin line
+        U64 allowed = get_bit(pinned, source) ? checkMask & lineSquares[kingSquare][source] : checkMask;
+
+        // captures
+        U64 captures = type != quietMoves ? pawnAttacks[us][source] & theirs & allowed : 0ULL;
+        while (captures) {
+            int target = popLs1bIndex(captures);
+
+            if (get_bit(promotionRank, target)) addPromotions(list, source, target, 1);
+            else addMove(list, encode_move(source, target, captureMove));
+        }
+
+        // single and double pushes (push promotions count as tactical moves)
+        int target = source + up;
+        if (!get_bit(occupancy, target)) {
+            if (get_bit(allowed, target)) {
+                if (get_bit(promotionRank, target)) {
+                    if (type != quietMoves) addPromotions(list, source, target, 0);
+                }
+                else if (type != tacticalMoves) {
+                    addMove(list, encode_move(source, target, quietMove));
+                }
+            }
+
+            if (type != tacticalMoves && get_bit(doublePushRank, source) && !get_bit(occupancy, target + up) &&
+                get_bit(allowed, target + up)) {
+                addMove(list, encode_move(source, target + up, doublePawnPush));
+            }
+        }
+    }
+
+    // en passant captures
+    if (type != quietMoves && board.enPassant != no_sq) {
+        int capturedSquare = board.enPassant - up;
+        U64 capturers = pawnAttacks[them][board.enPassant] & board.pieces[us][pawn];
+
+        // the capture has to resolve a check, by taking the checker or by blocking
+        if (!checkers || get_bit(checkMask, board.enPassant) || checkers == (1ULL << capturedSquare)) {
+            while (capturers) {
+                int source = popLs1bIndex(capturers);
+
+                // two pawns leave the board at once, test sliders against the resulting occupancy
+                U64 occupancyAfter = (occupancy ^ (1ULL << source) ^ (1ULL << capturedSquare)) |
+                                     (1ULL << board.enPassant);
+
+                if (!(getBishopAttacks(kingSquare, occupancyAfter) & theirDiagonals) &&
+                    !(getRookAttacks(kingSquare, occupancyAfter) & theirLines)) {
+                    addMove(list, encode_move(source, board.enPassant, enPassantCapture));
+                }
+            }
+        }
+    }
+
+    // castling (never out of check, king may not pass through attacked squares)
+    if (type != tacticalMoves && !checkers) {
+        constexpr int kingSideRight = us == white ? wk : bk;
+        constexpr int queenSideRight = us == white ? wq : bq;
+        constexpr int kingStart = us == white ? e1 : e8;
+
+        if ((board.castling & kingSideRight) &&
+            !get_bit(occupancy, kingStart + 1) && !get_bit(occupancy, kingStart + 2) &&
+            !isSquareAttacked<them>(board, kingStart + 1, occupancy) &&
+            !isSquareAttacked<them>(board, kingStart + 2, occupancy)) {
+            addMove(list, encode_move(kingStart, kingStart + 2, kingCastle));
+        }
+
+        if ((board.castling & queenSideRight) &&
+            !get_bit(occupancy, kingStart - 1) && !get_bit(occupancy, kingStart - 2) &&
+            !get_bit(occupancy, kingStart - 3) &&
+            !isSquareAttacked<them>(board, kingStart - 1, occupancy) &&
+            !isSquareAttacked<them>(board, kingStart - 2, occupancy)) {
+            addMove(list, encode_move(kingStart, kingStart - 2, queenCastle));
+        }
+    }
+}
+
+// generate legal moves of given type for side to move, appended to list
+template <int type>
+static inline void appendMoves(const CBoard &board, MoveList &list) {
+    stats_add(movegenCalls, 1);
+    stats_timer(movegenNs);
+
+    if (board.side == white) {
+        generateLegalMoves<white, type>(board, list);
+    }
+    else {
+        generateLegalMoves<black, type>(board, list);
+    }
+}
+
+// generate all legal moves of side to move
+static inline void generateMoves(const CBoard &board, MoveList &list) {
+    list.count = 0;
+    appendMoves<allMoves>(board, list);
+}
+
+// is move pseudo legal in position (tt, killer and counter moves are checked before they are played,
+// they may come from another position)
+bool isPseudoLegal(const CBoard &board, Move move) {
+    if (move == NO_MOVE) return false;
+
+    const int us = board.side;
+    const int source = get_move_source(move);
+    const int target = get_move_target(move);
+    const int flags = get_move_flags(move);
+    const int piece = board.mailbox[source];
+    const int captured = board.mailbox[target];
+    const U64 occupancy = board.occupancies[both];
+
+    if (piece == NO_PIECE || get_piece_color(piece) != us) return false;
+
+    // flags 6 and 7 are not used
+    if (flags > enPassantCapture && flags < knightPromotion) return false;
+
+    const int pieceType = get_piece_type(piece);
+
+    if (flags == enPassantCapture) {
+        return pieceType == pawn && target == board.enPassant && get_bit(pawnAttacks[us][source], target);
+    }
+
+    // capture flag must match the target square, kings are never captured
+    if ((is_capture(move) != 0) != (captured != NO_PIECE)) return false;
+    if (captured != NO_PIECE && (get_piece_color(captured) == us || get_piece_type(captured) == king)) return false;
+
+    if (flags == kingCastle || flags == queenCastle) {
+        const int kingStart = us == white ? e1 : e8;
+        const int right = flags == kingCastle ? (us == white ? wk : bk) : (us == white ? wq : bq);
+        const U64 between = flags == kingCastle ? (3ULL << (kingStart + 1)) : (7ULL << (kingStart - 3));
+        const int step = flags == kingCastle ? 1 : -1;
+
+        return pieceType == king && source == kingStart && target == kingStart + 2 * step &&
+               (board.castling & right) && !(occupancy & between) &&
+               !isSquareAttacked(board, kingStart, us ^ 1) && !isSquareAttacked(board, kingStart + step, us ^ 1);
+    }
+
+    if (pieceType == pawn) {
+        const int up = us == white ? -8 : 8;
+
+        // promotion flag must match the target rank
+        if ((is_promotion(move) != 0) != (get_bit(rank8 | rank1, target) != 0)) return false;
+
+        if (is_capture(move)) return get_bit(pawnAttacks[us][source], target) != 0;
+        if (flags == doublePawnPush) {
+            return get_bit(us == white ? rank2 : rank7, source) && target == source + 2 * up &&
+                   !get_bit(occupancy, source + up) && !get_bit(occupancy, target);
+        }
+        return target == source + up && !get_bit(occupancy, target);
+    }
+
+    // other pieces have no special flags
+    if (flags != quietMove && flags != captureMove) return false;
+
+    switch (pieceType) {
+        case knight: return get_bit(knightAttacks[source], target) != 0;
+        case bishop: return get_bit(getBishopAttacks(source, occupancy), target) != 0;
+        case rook: return get_bit(getRookAttacks(source, occupancy), target) != 0;
+        case queen: return get_bit(getQueenAttacks(source, occupancy), target) != 0;
+        default: return get_bit(kingAttacks[source], target) != 0;
+    }
+}
+
+// is pseudo legal move legal (does not leave own king attacked)
+bool isLegal(CBoard &board, Move move) {
+    board.makeMove(move);
+    bool legal = !isSquareAttacked(board, board.getKingSquare(board.side ^ 1), board.side);
+    board.unmakeMove(move);
+    return legal;
+}
+
+/*********************\
+ ======================
+      Attack Maps
+ ======================
+\*********************/
+
+// slider attack map kernels: per square magic lookups, Kogge-Stone occluded fill (scalar or avx2)
+// (measured by fillbench only, search and evaluation use the per square lookups)
+enum {
+    magicLoopFill, koggeStoneFill, koggeStoneAvx2Fill
+};
+
+const char *fillBackendNames[] = {"magic loop", "kogge-stone", "kogge-stone avx2"};
+
+// check whether cpu and os support avx2 (cpuid leaf 7 ebx bit 5, ymm state enabled in xcr0)
+int cpuHasAvx2() {
+#if AVX2_SUPPORTED
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    // osxsave (leaf 1 ecx bit 27) is needed to read xcr0
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1 << 27))) {
+        return 0;
+    }
+
+    unsigned int xcr0 = 0, xcr0High = 0;
+    asm("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+    if ((xcr0 & 6) != 6) {
+        return 0;
+    }
+
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1 << 5));
+#else
+    return 0;
+#endif
+}
+
+// wrap mask of a shift direction (squares a shift onto the opposite edge would land on)
+constexpr U64 fillWrapMask(int shift) {
+    return shift == 8 || shift == -8 ? ~0ULL :
+           shift == 1 || shift == 9 || shift == -7 ? not_a_file : not_h_file;
+}
+
+// shift bitboard by positive (towards h1) or negative (towards a8) amount
+constexpr U64 shiftBitboard(U64 bitboard, int shift) {
+    return shift > 0 ? bitboard << shift : bitboard >> -shift;
+}
+
+// attacks of every slider in generator set along one direction (Kogge-Stone occluded fill)
+template <int shift>
+static inline U64 koggeStoneAttacks(U64 generator, U64 empty) {
+    constexpr U64 mask = fillWrapMask(shift);
+    U64 propagator = empty & mask;
+
+    generator |= propagator & shiftBitboard(generator, shift);
+    propagator &= shiftBitboard(propagator, shift);
+    generator |= propagator & shiftBitboard(generator, 2 * shift);
+    propagator &= shiftBitboard(propagator, 2 * shift);
+    generator |= propagator & shiftBitboard(generator, 4 * shift);
+
+    return shiftBitboard(generator, shift) & mask;
+}
+
+// attacks of all line (rook, queen) and diagonal (bishop, queen) sliders, scalar Kogge-Stone
+U64 sliderAttacksKoggeStone(U64 lines, U64 diagonals, U64 occupancy) {
+    U64 empty = ~occupancy;
+
+    return koggeStoneAttacks<1>(lines, empty) | koggeStoneAttacks<-1>(lines, empty) |
+           koggeStoneAttacks<8>(lines, empty) | koggeStoneAttacks<-8>(lines, empty) |
+           koggeStoneAttacks<9>(diagonals, empty) | koggeStoneAttacks<-9>(diagonals, empty) |
+           koggeStoneAttacks<7>(diagonals, empty) | koggeStoneAttacks<-7>(diagonals, empty);
+}
+
+#if AVX2_SUPPORTED
+// attacks of all line and diagonal sliders, avx2 Kogge-Stone
+// (one 4 lane vector fills the four directions shifting towards h1, a second one the four towards a8)
+__attribute__((target("avx2")))
+U64 sliderAttacksKoggeStoneAvx2(U64 lines, U64 diagonals, U64 occupancy) {
+    // lanes: east / west, south / north (lines), south east / north west, south west / north east (diagonals)
+    const __m256i shift1 = _mm256_setr_epi64x(1, 8, 9, 7);
+    const __m256i shift2 = _mm256_setr_epi64x(2, 16, 18, 14);
+    const __m256i shift4 = _mm256_setr_epi64x(4, 32, 36, 28);
+    const __m256i maskUp = _mm256_setr_epi64x((long long) not_a_file, -1LL, (long long) not_a_file,
+                                              (long long) not_h_file);
+    const __m256i maskDown = _mm256_setr_epi64x((long long) not_h_file, -1LL, (long long) not_h_file,
+                                                (long long) not_a_file);
+
+    const __m256i generator = _mm256_setr_epi64x((long long) lines, (long long) lines,
+                                                 (long long) diagonals, (long long) diagonals);
+    const __m256i empty = _mm256_set1_epi64x((long long) ~occupancy);
+
+    // towards h1 (left shifts)
+    __m256i up = generator;
+    __m256i propagator = _mm256_and_si256(empty, maskUp);
+    up = _mm256_or_si256(up, _mm256_and_si256(propagator, _mm256_sllv_epi64(up, shift1)));
+    propagator = _mm256_and_si256(propagator, _mm256_sllv_epi64(propagator, shift1));
+    up = _mm256_or_si256(up, _mm256_and_si256(propagator, _mm256_sllv_epi64(up, shift2)));
+    propagator = _mm256_and_si256(propagator, _mm256_sllv_epi64(propagator, shift2));
+    up = _mm256_or_si256(up, _mm256_and_si256(propagator, _mm256_sllv_epi64(up, shift4)));
+    up = _mm256_and_si256(_mm256_sllv_epi64(up, shift1), maskUp);
+
+    // towards a8 (right shifts)
+    __m256i down = generator;
+    propagator = _mm256_and_si256(empty, maskDown);
+    down = _mm256_or_si256(down, _mm256_and_si256(propagator, _mm256_srlv_epi64(down, shift1)));
+    propagator = _mm256_and_si256(propagator, _mm256_srlv_epi64(propagator, shift1));
+    down = _mm256_or_si256(down, _mm256_and_si256(propagator, _mm256_srlv_epi64(down, shift2)));
+    propagator = _mm256_and_si256(propagator, _mm256_srlv_epi64(propagator, shift2));
+    down = _mm256_or_si256(down, _mm256_and_si256(propagator, _mm256_srlv_epi64(down, shift4)));
+    down = _mm256_and_si256(_mm256_srlv_epi64(down, shift1), maskDown);
+
+    // or all eight directions together
+    __m256i attacks = _mm256_or_si256(up, down);
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+
+    return (U64) _mm_cvtsi128_si64(half);
+}
+#endif
+
+// attacks of all line and diagonal sliders, one magic (or pext) lookup per slider
+U64 sliderAttacksMagicLoop(U64 lines, U64 diagonals, U64 occupancy) {
+    U64 attacks = 0ULL;
+
+    while (lines) {
+        attacks |= getRookAttacks(popLs1bIndex(lines), occupancy);
+    }
+    while (diagonals) {
+        attacks |= getBishopAttacks(popLs1bIndex(diagonals), occupancy);
+    }
+
+    return attacks;
+}
+
+// slider attack map kernel of a backend
+typedef U64 (*SliderFillKernel)(U64 lines, U64 diagonals, U64 occupancy);
+
+SliderFillKernel sliderFillKernel(int backend) {
+#if AVX2_SUPPORTED
+    if (backend == koggeStoneAvx2Fill) return sliderAttacksKoggeStoneAvx2;
+#endif
+    return backend == koggeStoneFill ? sliderAttacksKoggeStone : sliderAttacksMagicLoop;
+}
+
+// pick slider attack map backend, avx2 when supported, CHESS_FILL_BACKEND=magic|koggestone|avx2 forces one
+int selectFillBackend() {
+    const char *forced = getenv("CHESS_FILL_BACKEND");
+
+    if (forced && !strcmp(forced, "magic")) return magicLoopFill;
+    if (forced && !strcmp(forced, "koggestone")) return koggeStoneFill;
+
+    if (cpuHasAvx2()) return koggeStoneAvx2Fill;
+
+    if (forced && !strcmp(forced, "avx2")) {
+        fprintf(stderr, "avx2 not supported by cpu, preferring scalar kogge-stone\n");
+        return koggeStoneFill;
+    }
+
+    return magicLoopFill;
+}
+
+/*********************\
+ ======================
+         Perft
+ ======================
+\*********************/
+
+// count leaf nodes of move generation tree (leaves are bulk counted from the move list)
+U64 perft(CBoard &board, int depth) {
+    MoveList list;
+    generateMoves(board, list);
+
+    // bulk counting, moves are legal so no need to make them
+    if (depth <= 1) {
+        return depth == 1 ? list.count : 1;
+    }
+
+    U64 nodes = 0ULL;
+
+    for (int i = 0; i < list.count; i++) {
+        board.makeMove(list.moves[i]);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove(list.moves[i]);
+    }
+
+    return nodes;
+}
+
+// perft hash entry, key is stored XORed with data so torn writes of other threads fail verification
+struct PerftHashEntry {
+    std::atomic<U64> key;
+    std::atomic<U64> data;
+};
+
+// entries per bucket, one bucket fills a cache line
+#define PERFT_HASH_BUCKET_SIZE 4
+
+struct alignas(64) PerftHashBucket {
+    PerftHashEntry entries[PERFT_HASH_BUCKET_SIZE];
+};
+
+// perft data: leaf nodes in the low 56 bits, depth in the high 8 bits
+#define encode_perft_data(nodes, depth) ((nodes) | ((U64) (depth) << 56))
+#define get_perft_nodes(data) ((data) & 0xffffffffffffffULL)
+#define get_perft_depth(data) ((int) ((data) >> 56))
+
+// lockless perft hash table shared by all perft threads
+struct PerftHashTable {
+    PerftHashBucket *buckets = nullptr;
+    U64 bucketCount = 0ULL;
+
+    // probe statistics, threads add their local counts when done
+    std::atomic<U64> probes{0ULL};
+    std::atomic<U64> hits{0ULL};
+
+    ~PerftHashTable() {
+        delete[] buckets;
+    }
+
+    // resize to the largest power of two bucket count fitting into megabytes (0 disables the table)
+    void resize(int megabytes) {
+        delete[] buckets;
+        buckets = nullptr;
+        bucketCount = 0ULL;
+
+        U64 count = ((U64) megabytes << 20) / sizeof(PerftHashBucket);
+        if (!count) return;
+
+        bucketCount = 1ULL;
+        while (bucketCount * 2 <= count) bucketCount *= 2;
+
+        buckets = new PerftHashBucket[bucketCount];
+        clear();
+    }
+
+    void clear() {
+        for (U64 i = 0; i < bucketCount; i++) {
+            for (PerftHashEntry &entry : buckets[i].entries) {
+                entry.key.store(0ULL, std::memory_order_relaxed);
+                entry.data.store(0ULL, std::memory_order_relaxed);
+            }
+        }
+        probes = 0ULL;
+        hits = 0ULL;
+    }
+
+    // look up node count of position at depth
+    bool probe(U64 key, int depth, U64 &nodes) const {
+        PerftHashBucket &bucket = buckets[key & (bucketCount - 1)];
+
+        for (PerftHashEntry &entry : bucket.entries) {
+            U64 data = entry.data.load(std::memory_order_relaxed);
+
+            if ((entry.key.load(std::memory_order_relaxed) ^ data) == key && get_perft_depth(data) == depth) {
+                nodes = get_perft_nodes(data);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // store node count of position at depth
+    // (replaces the entry of the same position or else the shallowest one, deep subtrees save the most work)
+    void store(U64 key, int depth, U64 nodes) {
+        PerftHashBucket &bucket = buckets[key & (bucketCount - 1)];
+        PerftHashEntry *replace = &bucket.entries[0];
+
+        for (PerftHashEntry &entry : bucket.entries) {
+            U64 data = entry.data.load(std::memory_order_relaxed);
+
+            if ((entry.key.load(std::memory_order_relaxed) ^ data) == key) {
+                replace = &entry;
+                break;
+            }
+            if (get_perft_depth(data) < get_perft_depth(replace->data.load(std::memory_order_relaxed))) {
+                replace = &entry;
+            }
+        }
+
+        U64 data = encode_perft_data(nodes, depth);
+        replace->key.store(key ^ data, std::memory_order_relaxed);
+        replace->data.store(data, std::memory_order_relaxed);
+    }
+};
+
+// perft hash table (sized by perft hash option)
+PerftHashTable perftHashTable;
+
+// count leaf nodes of move generation tree, reusing node counts of transposed subtrees
+U64 perftHashed(CBoard &board, int depth, U64 &probes, U64 &hits) {
+    // bulk counted nodes are cheaper to count than to look up
+    if (depth <= 1) {
+        return perft(board, depth);
+    }
+
+    U64 nodes = 0ULL;
+
+    probes++;
+    if (perftHashTable.probe(board.hashKey, depth, nodes)) {
+        hits++;
+        return nodes;
+    }
+
+    MoveList list;
+    generateMoves(board, list);
+
+    for (int i = 0; i < list.count; i++) {
+        board.makeMove(list.moves[i]);
+        nodes += perftHashed(board, depth - 1, probes, hits);
+        board.unmakeMove(list.moves[i]);
+    }
+
+    perftHashTable.store(board.hashKey, depth, nodes);
+
+    return nodes;
+}
+
+// count leaf nodes with the perft hash table when it is allocated
+U64 perftNodes(CBoard &board, int depth) {
+    if (!perftHashTable.bucketCount) {
+        return perft(board, depth);
+    }
+
+    U64 probes = 0ULL, hits = 0ULL;
+    U64 nodes = perftHashed(board, depth, probes, hits);
+
+    perftHashTable.probes += probes;
+    perftHashTable.hits += hits;
+
+    return nodes;
+}
+
+// maximum plies a perft task can lie below the root
+#define MAX_SPLIT_PLY 16
+
+// tasks at or below this depth are never split further
+#define MIN_SPLIT_DEPTH 3
+
+// perft subtree task: moves leading from root to subtree and remaining depth
+struct PerftTask {
+    Move path[MAX_SPLIT_PLY];
+    int length;
+    int depth;
+};
+
+// per thread task deque, owner works on the back, thieves steal from the front
+struct PerftTaskQueue {
+    std::mutex mutex;
+    std::deque<PerftTask> tasks;
+
+    void push(const PerftTask &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(task);
+    }
+
+    bool pop(PerftTask &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    bool steal(PerftTask &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+};
+
+// count perft leaf nodes on multiple threads
+// (a task is split into its child subtrees while threads are idle or fewer tasks than threads are queued,
+// idle threads steal them)
+U64 parallelPerft(const CBoard &root, int depth, int threadCount) {
+    if (threadCount <= 1 || depth <= MIN_SPLIT_DEPTH) {
+        CBoard board = root;
+        return perftNodes(board, depth);
+    }
+
+    std::vector<PerftTaskQueue> queues(threadCount);
+    std::atomic<U64> totalNodes(0ULL);
+
+    // tasks created but not finished yet, tasks waiting in queues and threads looking for work
+    std::atomic<int> pending(1);
+    std::atomic<int> queued(1);
+    std::atomic<int> idle(0);
+
+    PerftTask rootTask;
+    rootTask.length = 0;
+    rootTask.depth = depth;
+    queues[0].push(rootTask);
+
+    auto worker = [&](int id) {
+        // every thread walks its own board copy from the root
+        CBoard *board = new CBoard(root);
+        U64 nodes = 0ULL;
+        PerftTask task;
+        bool searching = false;
+
+        while (pending > 0) {
+            // own tasks first, then try to steal from other threads
+            bool found = queues[id].pop(task);
+            for (int i = 1; !found && i < threadCount; i++) {
+                found = queues[(id + i) % threadCount].steal(task);
+            }
+
+            if (!found) {
+                if (!searching) {
+                    searching = true;
+                    idle++;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+
+            queued--;
+
+            if (searching) {
+                searching = false;
+                idle--;
+            }
+
+            for (int i = 0; i < task.length; i++) {
+                board->makeMove(task.path[i]);
+            }
+
+            // hand out child subtrees while other threads are (or are about to be) waiting for work
+            if ((idle > 0 || queued < threadCount) && task.depth > MIN_SPLIT_DEPTH && task.length < MAX_SPLIT_PLY) {
+                MoveList list;
+                generateMoves(*board, list);
+
+                PerftTask child = task;
+                child.length = task.length + 1;
+                child.depth = task.depth - 1;
+
+                pending += list.count;
+                queued += list.count;
+                for (int i = 0; i < list.count; i++) {
+                    child.path[task.length] = list.moves[i];
+                    queues[id].push(child);
+                }
+            }
+            else {
+                nodes += perftNodes(*board, task.depth);
+            }
+
+            for (int i = task.length - 1; i >= 0; i--) {
+                board->unmakeMove(task.path[i]);
+            }
+
+            pending--;
+        }
+
+        totalNodes += nodes;
+        delete board;
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker, i);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    return totalNodes;
+}
+
+// run perft and print nodes, time and speed (divide also prints node count per root move)
+U64 perftTest(CBoard &board, int depth, int divide, int threadCount) {
+    char moveString[6];
+    long long start = getTimeNs();
+    U64 nodes = 0ULL;
+
+    if (divide && depth > 0) {
+        MoveList list;
+        generateMoves(board, list);
+
+        for (int i = 0; i < list.count; i++) {
+            board.makeMove(list.moves[i]);
+            U64 moveNodes = parallelPerft(board, depth - 1, threadCount);
+            board.unmakeMove(list.moves[i]);
+
+            printf("  %-5s %llu\n", moveToString(list.moves[i], moveString), moveNodes);
+            nodes += moveNodes;
+        }
+
+        printf("\n  moves: %d\n", list.count);
+    }
+    else {
+        nodes = parallelPerft(board, depth, threadCount);
+    }
+
+    long long elapsed = getTimeNs() - start;
+
+    printf("  depth:   %d\n", depth);
+    printf("  threads: %d\n", threadCount);
+    printf("  nodes:   %llu\n", nodes);
+    printf("  time:    %.3f s\n", elapsed / 1e9);
+    printf("  nps:     %.0f\n", elapsed ? nodes * 1e9 / elapsed : 0.0);
+
+    if (perftHashTable.bucketCount) {
+        printf("  hash:    %llu MB  hit rate: %.2f%%\n", (perftHashTable.bucketCount * sizeof(PerftHashBucket)) >> 20,
+               perftHashTable.probes ? perftHashTable.hits * 100.0 / perftHashTable.probes : 0.0);
+    }
+    printf("\n");
+
+    return nodes;
+}
+
+// perft suite position with expected node count
+struct PerftPosition {
+    const char *fen;
+    int depth;
+    U64 nodes;
+};
+
+// well known perft positions (chessprogramming wiki and en passant / castling / promotion edge cases)
+const PerftPosition perftSuite[] = {
+        {START_POSITION, 6, 119060324ULL},
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690ULL},
+        {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 7, 178633661ULL},
+        {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292ULL},
+        {"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 5, 15833292ULL},
+        {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194ULL},
+        {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551ULL},
+        {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888ULL},
+        {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133ULL},
+        {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467ULL},
+        {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072ULL},
+        {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711ULL},
+        {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206ULL},
+        {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476ULL},
+        {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001ULL},
+        {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658ULL},
+        {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342ULL},
+        {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683ULL},
+        {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217ULL},
+        {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584ULL},
+        {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527ULL},
+};
+
+// run perft suite, depthLimit caps the depth of every position (0 = full depth)
+// with the perft hash table allocated every position is counted uncached and cached to compare both
+// returns number of failed positions
+int perftSuiteTest(int depthLimit, int threadCount) {
+    int failed = 0;
+    int hashed = perftHashTable.bucketCount != 0;
+    U64 totalNodes = 0ULL;
+    long long totalTime = 0, totalHashTime = 0;
+
+    printf("\n  %-3s %-5s %12s %12s  %-6s %8s", "#", "depth", "nodes", "expected", "result", "Mnps");
+    if (hashed) printf(" %8s %7s %7s", "hashMnps", "hit%", "speedup");
+    printf("  %s\n", "fen");
+
+    for (int i = 0; i < (int) (sizeof(perftSuite) / sizeof(perftSuite[0])); i++) {
+        const PerftPosition &position = perftSuite[i];
+        CBoard board;
+        board.parseFen(position.fen);
+
+        // shallower runs can only be checked by counting nodes
+        int depth = depthLimit && depthLimit < position.depth ? depthLimit : position.depth;
+
+        // uncached count (the table is detached while counting)
+        PerftHashBucket *buckets = perftHashTable.buckets;
+        U64 bucketCount = perftHashTable.bucketCount;
+        perftHashTable.buckets = nullptr;
+        perftHashTable.bucketCount = 0ULL;
+
+        long long start = getTimeNs();
+        U64 nodes = parallelPerft(board, depth, threadCount);
+        long long elapsed = getTimeNs() - start;
+
+        perftHashTable.buckets = buckets;
+        perftHashTable.bucketCount = bucketCount;
+
+        int checked = depth == position.depth;
+        int passed = !checked || nodes == position.nodes;
+
+        // cached count from an empty table must match the uncached one
+        U64 hashNodes = 0ULL;
+        long long hashElapsed = 0;
+        if (hashed) {
+            perftHashTable.clear();
+
+            start = getTimeNs();
+            hashNodes = parallelPerft(board, depth, threadCount);
+            hashElapsed = getTimeNs() - start;
+
+            passed = passed && hashNodes == nodes;
+        }
+
+        printf("  %-3d %-5d %12llu %12s  %-6s %8.2f", i + 1, depth, nodes,
+               checked ? std::to_string(position.nodes).c_str() : "-",
+               checked || hashed ? (passed ? "pass" : "FAIL") : "-",
+               elapsed ? nodes * 1e3 / elapsed : 0.0);
+        if (hashed) {
+            printf(" %8.2f %7.2f %7.2f", hashElapsed ? hashNodes * 1e3 / hashElapsed : 0.0,
+                   perftHashTable.probes ? perftHashTable.hits * 100.0 / perftHashTable.probes : 0.0,
+                   hashElapsed ? (double) elapsed / hashElapsed : 0.0);
+        }
+        printf("  %s\n", position.fen);
+
+        failed += !passed;
+        totalNodes += nodes;
+        totalTime += elapsed;
+        totalHashTime += hashElapsed;
+    }
+
+    printf("\n  nodes: %llu  time: %.3f s  nps: %.0f  failed: %d\n", totalNodes, totalTime / 1e9,
+           totalTime ? totalNodes * 1e9 / totalTime : 0.0, failed);
+    if (hashed) {
+        printf("  hash time: %.3f s  hash nps: %.0f  speedup: %.2f\n", totalHashTime / 1e9,
+               totalHashTime ? totalNodes * 1e9 / totalHashTime : 0.0,
+               totalHashTime ? (double) totalTime / totalHashTime : 0.0);
+    }
+    printf("\n");
+
+    return failed;
+}
+
+/*********************\
+ ======================
+    Endgame Bitbase
+ ======================
+\*********************/
+
+// king and pawn versus king positions with white as the pawn side: black king, side to move, white king and the
+// pawn on files a to d (e to h are mirrored) and ranks 2 to 7
+#define KPK_SIZE (2 * 64 * 64 * 24)
+
+// one bit per position, set if white wins (24 KB), every word holds the black king squares of one side to move,
+// white king and pawn
+struct KpkBitbase {
+    U64 wins[KPK_SIZE / 64];
+};
+
+// bitbase index of position
+static constexpr int kpkIndex(int side, int blackKing, int whiteKing, int pawnSquare) {
+    return blackKing | (side << 6) | (whiteKing << 7) | ((pawnSquare % 8) << 13) | ((pawnSquare / 8 - 1) << 15);
+}
+
+// squares a king on any square of set attacks
+constexpr U64 kingFill(U64 squares) {
+    U64 attacks = 0ULL;
+    for (int shift : {-9, -8, -7, -1, 1, 7, 8, 9}) attacks |= shiftBitboard(squares, shift) & fillWrapMask(shift);
+    return attacks;
+}
+
+// generate kpk bitbase by retrograde analysis on whole words of black king squares: white wins if one of its moves
+// reaches a won black to move position, black loses if none of its king moves reaches a white to move position that
+// isn't won yet, positions still open when nothing changes are draws
+constexpr KpkBitbase init_kpk_bitbase() {
+    KpkBitbase bitbase{};
+
+    // legal white to move positions, positions not classified yet
+    U64 whiteLegal[KPK_SIZE / 64] = {};
+    U64 open[KPK_SIZE / 64] = {};
+
+    for (int pawnSquare = 8; pawnSquare < 56; pawnSquare++) {
+        if (pawnSquare % 8 > 3) continue;
+
+        for (int whiteKing = 0; whiteKing < 64; whiteKing++) {
+            if (whiteKing == pawnSquare) continue;
+
+            int whiteWord = kpkIndex(white, 0, whiteKing, pawnSquare) / 64;
+            int blackWord = kpkIndex(black, 0, whiteKing, pawnSquare) / 64;
+            U64 legal = ~(kingAttacks[whiteKing] | (1ULL << whiteKing) | (1ULL << pawnSquare));
+            whiteLegal[whiteWord] = legal & ~pawnAttacks[white][pawnSquare];
+
+            // pawn on the seventh promotes safely when the black king can't take the new queen
+            int promotionSquare = pawnSquare - 8;
+            if (pawnSquare / 8 == 1 && whiteKing != promotionSquare) {
+                bitbase.wins[whiteWord] = whiteLegal[whiteWord] &
+                        (get_bit(kingAttacks[whiteKing], promotionSquare)
+                         ? ~0ULL : ~(kingAttacks[promotionSquare] | (1ULL << promotionSquare)));
+            }
+
+            // stalemate or undefended pawn taken
+            U64 guarded = kingAttacks[whiteKing] | pawnAttacks[white][pawnSquare];
+            U64 draws = ~kingFill(~guarded) | (get_bit(guarded, pawnSquare) ? 0ULL : kingAttacks[pawnSquare]);
+
+            open[whiteWord] = whiteLegal[whiteWord] & ~bitbase.wins[whiteWord];
+            open[blackWord] = legal & ~draws;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (int pawnSquare = 8; pawnSquare < 56; pawnSquare++) {
+            if (pawnSquare % 8 > 3) continue;
+
+            for (int whiteKing = 0; whiteKing < 64; whiteKing++) {
+                if (whiteKing == pawnSquare) continue;
+
+                int whiteWord = kpkIndex(white, 0, whiteKing, pawnSquare) / 64;
+                int blackWord = kpkIndex(black, 0, whiteKing, pawnSquare) / 64;
+
+                // white king moves and pushes to the seventh (promotions are resolved above), a king on the pawn's
+                // or the pushed pawn's square has no wins
+                U64 reached = 0ULL;
+                U64 kingMoves = kingAttacks[whiteKing];
+                while (kingMoves) {
+                    reached |= bitbase.wins[kpkIndex(black, 0, popLs1bIndex(kingMoves), pawnSquare) / 64];
+                }
+
+                if (pawnSquare / 8 > 1) reached |= bitbase.wins[kpkIndex(black, 0, whiteKing, pawnSquare - 8) / 64];
+
+                if (pawnSquare / 8 == 6 && whiteKing != pawnSquare - 8) {
+                    reached |= bitbase.wins[kpkIndex(black, 0, whiteKing, pawnSquare - 16) / 64] &
+                               ~(1ULL << (pawnSquare - 8));
+                }
+
+                U64 won = open[whiteWord] & reached;
+
+                // every black king move lands on a won position (illegal ones aren't moves)
+                U64 lost = open[blackWord] & ~kingFill(whiteLegal[whiteWord] & ~bitbase.wins[whiteWord] & ~won);
+
+                if (won | lost) {
+                    bitbase.wins[whiteWord] |= won;
+                    bitbase.wins[blackWord] |= lost;
+                    open[whiteWord] &= ~won;
+                    open[blackWord] &= ~lost;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return bitbase;
+}
+
+// kpk bitbase, generated at compile time
+constexpr KpkBitbase kpkBitbase = init_kpk_bitbase();
+
+// is board a king and pawn versus king ending the bitbase covers (checked here rather than trusting the FEN, the
+// index of a pawn on the first or last rank is past the end of the table)
+static inline bool isKpk(const CBoard &board) {
+    U64 pawns = board.pieces[white][pawn] | board.pieces[black][pawn];
+
+    return countBits(board.occupancies[both]) == 3 && countBits(board.pieces[white][king]) == 1 &&
+           countBits(board.pieces[black][king]) == 1 && pawns && !(pawns & 0xFF000000000000FFULL);
+}
+
+// does the pawn side win king and pawn versus king board (O(1) bitbase lookup, only valid where isKpk holds)
+static inline bool kpkProbe(const CBoard &board) {
+    int strongSide = board.pieces[white][pawn] ? white : black;
+
+    // seen from the pawn side as white: black pawns mirror the ranks, pawns on files e to h mirror the files
+    int flip = strongSide == white ? 0 : 56;
+    int pawnSquare = ls1bIndex(board.pieces[strongSide][pawn]) ^ flip;
+    if (pawnSquare % 8 > 3) {
+        flip ^= 7;
+        pawnSquare ^= 7;
+    }
+
+    int index = kpkIndex(board.side == strongSide ? white : black, board.getKingSquare(strongSide ^ 1) ^ flip,
+                         board.getKingSquare(strongSide) ^ flip, pawnSquare);
+
+    return kpkBitbase.wins[index / 64] >> (index % 64) & 1;
+}
+
+/*********************\
+ ======================
+       Evaluation
+ ======================
+\*********************/
+
+// material scores [piece type]
+const int materialScore[6] = {100, 300, 320, 500, 900, 0};
+
+// piece square tables [piece type][square] from white's point of view (black mirrors the square)
+const int positionalScore[6][64] = {
+        // pawn
+        {
+                 0,   0,   0,   0,   0,   0,   0,   0,
+                50,  50,  50,  50,  50,  50,  50,  50,
+                10,  10,  20,  30,  30,  20,  10,  10,
+                 5,   5,  10,  25,  25,  10,   5,   5,
+                 0,   0,   0,  20,  20,   0,   0,   0,
+                 5,  -5, -10,   0,   0, -10,  -5,   5,
+                 5,  10,  10, -20, -20,  10,  10,   5,
+                 0,   0,   0,   0,   0,   0,   0,   0
+        },
+        // knight
+        {
+               -50, -40, -30, -30, -30, -30, -40, -50,
+               -40, -20,   0,   0,   0,   0, -20, -40,
+               -30,   0,  10,  15,  15,  10,   0, -30,
+               -30,   5,  15,  20,  20,  15,   5, -30,
+               -30,   0,  15,  20,  20,  15,   0, -30,
+               -30,   5,  10,  15,  15,  10,   5, -30,
+               -40, -20,   0,   5,   5,   0, -20, -40,
+               -50, -40, -30, -30, -30, -30, -40, -50
+        },
+        // bishop
+        {
+               -20, -10, -10, -10, -10, -10, -10, -20,
+               -10,   0,   0,   0,   0,   0,   0, -10,
+               -10,   0,   5,  10,  10,   5,   0, -10,
+               -10,   5,   5,  10,  10,   5,   5, -10,
+               -10,   0,  10,  10,  10,  10,   0, -10,
+               -10,  10,  10,  10,  10,  10,  10, -10,
+               -10,   5,   0,   0,   0,   0,   5, -10,
+               -20, -10, -10, -10, -10, -10, -10, -20
+        },
+        // rook
+        {
+                 0,   0,   0,   0,   0,   0,   0,   0,
+                 5,  10,  10,  10,  10,  10,  10,   5,
+                -5,   0,   0,   0,   0,   0,   0,  -5,
+                -5,   0,   0,   0,   0,   0,   0,  -5,
+                -5,   0,   0,   0,   0,   0,   0,  -5,
+                -5,   0,   0,   0,   0,   0,   0,  -5,
+                -5,   0,   0,   0,   0,   0,   0,  -5,
+                 0,   0,   0,   5,   5,   0,   0,   0
+        },
+        // queen
+        {
+               -20, -10, -10,  -5,  -5, -10, -10, -20,
+               -10,   0,   0,   0,   0,   0,   0, -10,
+               -10,   0,   5,   5,   5,   5,   0, -10,
+                -5,   0,   5,   5,   5,   5,   0,  -5,
+                 0,   0,   5,   5,   5,   5,   0,  -5,
+               -10,   5,   5,   5,   5,   5,   0, -10,
+               -10,   0,   5,   0,   0,   0,   0, -10,
+               -20, -10, -10,  -5,  -5, -10, -10, -20
+        },
+        // king
+        {
+               -30, -40, -40, -50, -50, -40, -40, -30,
+               -30, -40, -40, -50, -50, -40, -40, -30,
+               -30, -40, -40, -50, -50, -40, -40, -30,
+               -30, -40, -40, -50, -50, -40, -40, -30,
+               -20, -30, -30, -40, -40, -30, -30, -20,
+               -10, -20, -20, -20, -20, -20, -20, -10,
+                20,  20,   0,   0,   0,   0,  20,  20,
+                20,  30,  10,   0,   0,  10,  30,  20
+        },
+};
+
+// pawn structure scores
+const int passedPawnBonus[8] = {0, 10, 15, 25, 40, 65, 100, 0};
+#define DOUBLED_PAWN_PENALTY 10
+#define ISOLATED_PAWN_PENALTY 10
+#define BACKWARD_PAWN_PENALTY 8
+
+// king shelter scores: pawn one or two ranks in front of the king, no pawn in front on the file
+#define SHELTER_CLOSE_BONUS 10
+#define SHELTER_FAR_BONUS 5
+#define SHELTER_OPEN_FILE_PENALTY 10
+
+// pawn structure masks
+struct PawnMasks {
+    // squares of file and of its neighbour files
+    U64 files[8];
+    U64 adjacentFiles[8];
+
+    // squares in front of pawn of color on its file, and on its own and neighbour files
+    U64 forward[2][64];
+    U64 passed[2][64];
+
+    // squares on neighbour files level with or behind pawn of color
+    U64 support[2][64];
+};
+
+// init pawn structure masks
+constexpr PawnMasks init_pawn_masks() {
+    PawnMasks masks{};
+
+    for (int file = 0; file < 8; file++) {
+        for (int rank = 0; rank < 8; rank++) {
+            masks.files[file] |= 1ULL << (rank * 8 + file);
+        }
+    }
+
+    for (int file = 0; file < 8; file++) {
+        if (file > 0) masks.adjacentFiles[file] |= masks.files[file - 1];
+        if (file < 7) masks.adjacentFiles[file] |= masks.files[file + 1];
+    }
+
+    for (int square = 0; square < 64; square++) {
+        int file = square % 8;
+        int rank = square / 8;
+
+        for (int other = 0; other < 64; other++) {
+            U64 bitboard = 1ULL << other;
+            int otherRank = other / 8;
+            bool onFile = other % 8 == file;
+            bool onAdjacentFile = (masks.adjacentFiles[file] & bitboard) != 0;
+
+            // white pawns move towards rank index 0
+            if (otherRank < rank && (onFile || onAdjacentFile)) masks.passed[white][square] |= bitboard;
+            if (otherRank > rank && (onFile || onAdjacentFile)) masks.passed[black][square] |= bitboard;
+            if (otherRank < rank && onFile) masks.forward[white][square] |= bitboard;
+            if (otherRank > rank && onFile) masks.forward[black][square] |= bitboard;
+            if (otherRank >= rank && onAdjacentFile) masks.support[white][square] |= bitboard;
+            if (otherRank <= rank && onAdjacentFile) masks.support[black][square] |= bitboard;
+        }
+    }
+
+    return masks;
+}
+
+// pawn structure masks, generated at compile time
+constexpr PawnMasks pawnMasks = init_pawn_masks();
+
+// rank of square from color's point of view (0 = own back rank)
+static inline int relativeRank(int color, int square) {
+    return color == white ? 7 - square / 8 : square / 8;
+}
+
+// doubled, isolated, backward and passed pawns of color from its own point of view, passed pawns are added to passed
+static int evaluatePawnStructure(U64 pawns, U64 enemyPawns, int color, U64 &passed) {
+    int score = 0;
+    U64 bitboard = pawns;
+
+    while (bitboard) {
+        int square = popLs1bIndex(bitboard);
+
+        // a pawn behind another one of its side is doubled and never passed
+        if (pawnMasks.forward[color][square] & pawns) {
+            score -= DOUBLED_PAWN_PENALTY;
+        }
+        else if (!(pawnMasks.passed[color][square] & enemyPawns)) {
+            passed |= 1ULL << square;
+            score += passedPawnBonus[relativeRank(color, square)];
+        }
+
+        // backward: no pawn of its side can support it and an enemy pawn controls its stop square
+        if (!(pawnMasks.adjacentFiles[square % 8] & pawns)) {
+            score -= ISOLATED_PAWN_PENALTY;
+        }
+        else if (!(pawnMasks.support[color][square] & pawns) &&
+                 (pawnAttacks[color][square + (color == white ? -8 : 8)] & enemyPawns)) {
+            score -= BACKWARD_PAWN_PENALTY;
+        }
+    }
+
+    return score;
+}
+
+// pawn shield of king of color on kingSquare from its own point of view (only kings on their first two ranks)
+static int evaluateShelter(U64 pawns, int color, int kingSquare) {
+    if (relativeRank(color, kingSquare) > 1) return 0;
+
+    int score = 0;
+    int kingFile = kingSquare % 8;
+    int step = color == white ? -8 : 8;
+
+    for (int file = std::max(kingFile - 1, 0); file <= std::min(kingFile + 1, 7); file++) {
+        int square = kingSquare - kingFile + file;
+
+        if (pawns & (1ULL << (square + step))) score += SHELTER_CLOSE_BONUS;
+        else if (pawns & (1ULL << (square + 2 * step))) score += SHELTER_FAR_BONUS;
+        else if (!(pawns & pawnMasks.forward[color][square])) score -= SHELTER_OPEN_FILE_PENALTY;
+    }
+
+    return score;
+}
+
+// pawn hash table entry: pawn structure terms of one pawn structure and the king shelters last computed for it
+struct PawnEntry {
+    U64 key;
+    U64 passed[2];
+
+    // pawn structure score from white's point of view
+    int16_t score;
+
+    // shelter of each side and the king square it was computed for (no_sq if none)
+    int16_t shelter[2];
+    int8_t shelterKing[2];
+};
+
+// pawn hash table entries per thread (power of two)
+#define PAWN_HASH_ENTRIES 8192
+
+// per thread pawn hash table, indexed by the pawn key (pawn structures repeat in almost every node)
+struct PawnHashTable {
+    PawnEntry *entries;
+
+    // probes and hits since the last reset
+    U64 probes = 0ULL;
+    U64 hits = 0ULL;
+
+    PawnHashTable() : entries(new PawnEntry[PAWN_HASH_ENTRIES]) {
+        clear();
+    }
+
+    ~PawnHashTable() {
+        delete[] entries;
+    }
+
+    void clear() {
+        for (int i = 0; i < PAWN_HASH_ENTRIES; i++) {
+            entries[i] = PawnEntry{};
+            entries[i].shelterKing[white] = entries[i].shelterKing[black] = no_sq;
+        }
+        probes = hits = 0ULL;
+    }
+
+    // entry of pawn structure of board, evaluated on a miss
+    PawnEntry &probe(const CBoard &board) {
+        PawnEntry &entry = entries[board.pawnKey & (PAWN_HASH_ENTRIES - 1)];
+
+        probes++;
+        // pawn key of no pawns is zero, which empty entries already describe
+        if (entry.key == board.pawnKey) {
+            hits++;
+            return entry;
+        }
+
+        evaluateEntry(board, entry);
+        return entry;
+    }
+
+    // evaluate pawn structure of board into entry
+    static void evaluateEntry(const CBoard &board, PawnEntry &entry) {
+        U64 whitePawns = board.pieces[white][pawn];
+        U64 blackPawns = board.pieces[black][pawn];
+
+        entry.key = board.pawnKey;
+        entry.passed[white] = entry.passed[black] = 0ULL;
+        entry.score = (int16_t) (evaluatePawnStructure(whitePawns, blackPawns, white, entry.passed[white]) -
+                                 evaluatePawnStructure(blackPawns, whitePawns, black, entry.passed[black]));
+        entry.shelterKing[white] = entry.shelterKing[black] = no_sq;
+    }
+};
+
+// pawn hash table of thread (allocated on first use)
+thread_local PawnHashTable pawnHashTable;
+
+// pawn terms of board from white's point of view, through the pawn hash table or computed from scratch
+template <bool usePawnHash>
+static inline int evaluatePawns(const CBoard &board) {
+    PawnEntry scratch;
+    PawnEntry *entry = &scratch;
+
+    if (usePawnHash) entry = &pawnHashTable.probe(board);
+    else PawnHashTable::evaluateEntry(board, scratch);
+
+    int score = entry->score;
+
+    for (int color = white; color <= black; color++) {
+        // shelters only change with king moves, kept in the entry for the last king square
+        int kingSquare = board.getKingSquare(color);
+        if (entry->shelterKing[color] != kingSquare) {
+            entry->shelter[color] = (int16_t) evaluateShelter(board.pieces[color][pawn], color, kingSquare);
+            entry->shelterKing[color] = (int8_t) kingSquare;
+        }
+
+        // passed pawns with a free path to promotion
+        int sign = color == white ? 1 : -1;
+        U64 passed = entry->passed[color];
+        while (passed) {
+            int square = popLs1bIndex(passed);
+            if (!(pawnMasks.forward[color][square] & board.occupancies[both])) {
+                score += sign * passedPawnBonus[relativeRank(color, square)] / 2;
+            }
+        }
+
+        score += sign * entry->shelter[color];
+    }
+
+    return score;
+}
+
+// network scores are kept clear of mate scores
+#define NNUE_SCORE_LIMIT 20000
+
+// network feature of piece on square from perspective's point of view (black sees the board flipped)
+static inline int nnueFeature(int perspective, int kingSquare, int piece, int square) {
+    int flip = perspective == white ? 0 : 56;
+    int kind = (get_piece_color(piece) != perspective) * 5 + get_piece_type(piece);
+
+    return ((kingSquare ^ flip) * 10 + kind) * 64 + (square ^ flip);
+}
+
+// refresh cache entry: accumulator of the last position refreshed with this point of view and king square,
+// together with the pieces it was computed for
+struct NnueRefreshEntry {
+    alignas(64) int16_t values[NNUE_HIDDEN];
+    U64 pieces[2][6];
+};
+
+struct NnueRefreshCache {
+    NnueRefreshEntry entries[2][64];
+    int generation = 0;
+};
+
+// per thread refresh cache, a refresh only applies the pieces that differ from the cached position
+thread_local NnueRefreshCache nnueRefreshCache;
+
+// recompute point of view of board (king on kingSquare) through the refresh cache
+void nnueRefresh(const CBoard &board, int perspective, int kingSquare) {
+    NnueRefreshCache &cache = nnueRefreshCache;
+
+    // entries of another network restart from the empty board
+    if (cache.generation != nnueGeneration) {
+        for (auto &entries : cache.entries) {
+            for (NnueRefreshEntry &entry : entries) {
+                memcpy(entry.values, nnue.transformerBiases, sizeof(entry.values));
+                memset(entry.pieces, 0, sizeof(entry.pieces));
+            }
+        }
+        cache.generation = nnueGeneration;
+    }
+
+    NnueRefreshEntry &entry = cache.entries[perspective][kingSquare];
+    int added[32], removed[32];
+    int addCount = 0, removeCount = 0;
+
+    for (int color = white; color <= black; color++) {
+        for (int type = pawn; type < king; type++) {
+            U64 current = board.pieces[color][type];
+            U64 appeared = current & ~entry.pieces[color][type];
+            U64 vanished = entry.pieces[color][type] & ~current;
+
+            while (appeared) {
+                added[addCount++] = nnueFeature(perspective, kingSquare, make_piece(color, type),
+                                                popLs1bIndex(appeared));
+            }
+            while (vanished) {
+                removed[removeCount++] = nnueFeature(perspective, kingSquare, make_piece(color, type),
+                                                     popLs1bIndex(vanished));
+            }
+
+            entry.pieces[color][type] = current;
+        }
+    }
+
+    nnueUpdate(entry.values, added, addCount, removed, removeCount);
+    memcpy(board.accumulator.values[perspective], entry.values, sizeof(entry.values));
+    board.accumulator.kingSquare[perspective] = kingSquare;
+}
+
+// network evaluation from the side to move's point of view, the accumulator is brought up to date first
+int nnueEvaluate(const CBoard &board) {
+    NnueAccumulator &accumulator = board.accumulator;
+
+    if (accumulator.generation != nnueGeneration) {
+        accumulator.reset();
+        accumulator.generation = nnueGeneration;
+    }
+
+    for (int perspective = white; perspective <= black; perspective++) {
+        int kingSquare = board.getKingSquare(perspective);
+
+        // king moved (or stale values): refresh, otherwise apply the queued changes
+        if (accumulator.kingSquare[perspective] != kingSquare) {
+            nnueRefresh(board, perspective, kingSquare);
+        }
+        else if (accumulator.changeCount) {
+            int added[NNUE_MAX_CHANGES], removed[NNUE_MAX_CHANGES];
+            int addCount = 0, removeCount = 0;
+
+            for (int i = 0; i < accumulator.changeCount; i++) {
+                int change = abs(accumulator.changes[i]) - 1;
+                int feature = nnueFeature(perspective, kingSquare, change / 64, change % 64);
+
+                if (accumulator.changes[i] > 0) added[addCount++] = feature;
+                else removed[removeCount++] = feature;
+            }
+
+            nnueUpdate(accumulator.values[perspective], added, addCount, removed, removeCount);
+        }
+    }
+
+    accumulator.changeCount = 0;
+
+    int score = nnuePropagate(accumulator.values[board.side], accumulator.values[board.side ^ 1]) / NNUE_OUTPUT_SCALE;
+    return std::max(-NNUE_SCORE_LIMIT, std::min(score, NNUE_SCORE_LIMIT));
+}
+
+// network evaluation computed from scratch with the scalar kernels (reference for nnueEvaluate)
+int nnueEvaluateFromScratch(const CBoard &board) {
+    alignas(64) int16_t values[2][NNUE_HIDDEN];
+
+    for (int perspective = white; perspective <= black; perspective++) {
+        int kingSquare = board.getKingSquare(perspective);
+        memcpy(values[perspective], nnue.transformerBiases, sizeof(values[perspective]));
+
+        for (int square = 0; square < 64; square++) {
+            int piece = board.mailbox[square];
+            if (piece == NO_PIECE || get_piece_type(piece) == king) continue;
+
+            int feature = nnueFeature(perspective, kingSquare, piece, square);
+            nnueUpdateScalar(values[perspective], &feature, 1, nullptr, 0);
+        }
+    }
+
+    int score = nnuePropagateScalar(values[board.side], values[board.side ^ 1]) / NNUE_OUTPUT_SCALE;
+    return std::max(-NNUE_SCORE_LIMIT, std::min(score, NNUE_SCORE_LIMIT));
+}
+
+// pick network kernels, avx2 when supported, CHESS_NNUE_BACKEND=scalar|avx2 forces either one
+int selectNnueBackend() {
+    const char *forced = getenv("CHESS_NNUE_BACKEND");
+
+    if (forced && !strcmp(forced, "scalar")) return scalarNnue;
+
+    if (AVX2_SUPPORTED && cpuHasAvx2()) return avx2Nnue;
+
+    if (forced && !strcmp(forced, "avx2")) {
+        fprintf(stderr, "avx2 not supported by cpu, using scalar network kernels\n");
+    }
+
+    return scalarNnue;
+}
+
+// material, piece squares and pawn terms from side to move's point of view
+template <bool usePawnHash>
+int evaluateHandcrafted(const CBoard &board) {
+    int score = evaluatePawns<usePawnHash>(board);
+
+    for (int type = pawn; type <= king; type++) {
+        U64 bitboard = board.pieces[white][type];
+        while (bitboard) {
+            score += materialScore[type] + positionalScore[type][popLs1bIndex(bitboard)];
+        }
+
+        bitboard = board.pieces[black][type];
+        while (bitboard) {
+            score -= materialScore[type] + positionalScore[type][popLs1bIndex(bitboard) ^ 56];
+        }
+    }
+
+    return board.side == white ? score : -score;
+}
+
+// king and pawn versus king scores: a won ending is worth a few pawns more the further the pawn is, less than the
+// queen it promotes to
+#define KPK_WIN_SCORE 400
+#define KPK_RANK_BONUS 20
+
+// king and pawn versus king from side to move's point of view, bitbase draws are exactly zero
+int evaluateKpk(const CBoard &board) {
+    int strongSide = board.pieces[white][pawn] ? white : black;
+    if (!kpkProbe(board)) return 0;
+
+    int score = KPK_WIN_SCORE + KPK_RANK_BONUS * relativeRank(strongSide, ls1bIndex(board.pieces[strongSide][pawn]));
+    return board.side == strongSide ? score : -score;
+}
+
+// static evaluation from side to move's point of view (network when loaded, else handcrafted terms)
+int evaluate(const CBoard &board) {
+    stats_add(evalCalls, 1);
+    stats_timer(evalNs);
+
+    if (isKpk(board)) return evaluateKpk(board);
+
+    if (nnueActive) return nnueEvaluate(board);
+
+    return evaluateHandcrafted<true>(board);
+}
+
+/*********************\
+ ======================
+   Transposition Table
+ ======================
+\*********************/
+
+// default transposition table size in megabytes
+#define DEFAULT_HASH_MB 16
+
+// score bound types
+enum {hashExact = 1, hashAlpha, hashBeta};
+
+// transposition table entry, key is stored XORed with data (lockless, torn entries fail verification)
+struct TTEntry {
+    std::atomic<U64> key;
+    std::atomic<U64> data;
+};
+
+// entries per bucket, one bucket fills a cache line
+#define TT_BUCKET_SIZE 4
+
+struct alignas(64) TTBucket {
+    TTEntry entries[TT_BUCKET_SIZE];
+};
+
+// tt data: move (16 bits), score (16 bits), depth (8 bits), bound (8 bits), age (8 bits)
+#define encode_tt_data(move, score, depth, bound, age) \
+    ((U64) (move) | ((U64) (unsigned short) (score) << 16) | ((U64) (depth) << 32) | \
+     ((U64) (bound) << 40) | ((U64) (age) << 48))
+#define get_tt_move(data) ((Move) ((data) & 0xffff))
+#define get_tt_score(data) ((int) (short) (((data) >> 16) & 0xffff))
+#define get_tt_depth(data) ((int) (((data) >> 32) & 0xff))
+#define get_tt_bound(data) ((int) (((data) >> 40) & 0xff))
+#define get_tt_age(data) ((int) (((data) >> 48) & 0xff))
+
+// lockless transposition table shared by all search threads
+struct TranspositionTable {
+    TTBucket *buckets = nullptr;
+    U64 bucketCount = 0ULL;
+
+    // search generation, entries of older searches are replaced first (batch searches bump it concurrently)
+    std::atomic<int> age{0};
+
+    ~TranspositionTable() {
+        delete[] buckets;
+    }
+
+    // resize to the largest power of two bucket count fitting into megabytes
+    void resize(int megabytes) {
+        delete[] buckets;
+
+        U64 count = ((U64) (megabytes > 0 ? megabytes : 1) << 20) / sizeof(TTBucket);
+
+        bucketCount = 1ULL;
+        while (bucketCount * 2 <= count) bucketCount *= 2;
+
+        buckets = new TTBucket[bucketCount];
+        clear();
+    }
+
+    void clear() {
+        for (U64 i = 0; i < bucketCount; i++) {
+            for (TTEntry &entry : buckets[i].entries) {
+                entry.key.store(0ULL, std::memory_order_relaxed);
+                entry.data.store(0ULL, std::memory_order_relaxed);
+            }
+        }
+        age = 0;
+    }
+
+    // start new search generation
+    void newSearch() {
+        age = (age.load(std::memory_order_relaxed) + 1) & 0xff;
+    }
+
+    // look up position, data holds the packed entry on success
+    bool probe(U64 key, U64 &data) const {
+        TTBucket &bucket = buckets[key & (bucketCount - 1)];
+
+        for (TTEntry &entry : bucket.entries) {
+            data = entry.data.load(std::memory_order_relaxed);
+            if ((entry.key.load(std::memory_order_relaxed) ^ data) == key && data) return true;
+        }
+
+        return false;
+    }
+
+    // store position (replaces the entry of the same position or else the shallowest and oldest one)
+    void store(U64 key, Move move, int score, int depth, int bound) {
+        TTBucket &bucket = buckets[key & (bucketCount - 1)];
+        TTEntry *replace = nullptr;
+        int replaceValue = 0;
+        int currentAge = age.load(std::memory_order_relaxed);
+
+        for (TTEntry &entry : bucket.entries) {
+            U64 data = entry.data.load(std::memory_order_relaxed);
+
+            if ((entry.key.load(std::memory_order_relaxed) ^ data) == key) {
+                // keep the known best move when the new search has none
+                if (move == NO_MOVE) move = get_tt_move(data);
+                replace = &entry;
+                break;
+            }
+
+            int value = get_tt_depth(data) - 8 * ((currentAge - get_tt_age(data)) & 0xff);
+            if (!replace || value < replaceValue) {
+                replace = &entry;
+                replaceValue = value;
+            }
+        }
+
+#if SEARCH_STATS_ENABLED
+        // evicting a used entry of another position
+        U64 replaced = replace->data.load(std::memory_order_relaxed);
+        if (replaced && (replace->key.load(std::memory_order_relaxed) ^ replaced) != key) {
+            stats_add(ttCollisions, 1);
+        }
+#endif
+
+        U64 data = encode_tt_data(move, score, depth, bound, currentAge);
+        replace->key.store(key ^ data, std::memory_order_relaxed);
+        replace->data.store(data, std::memory_order_relaxed);
+    }
+
+    // permille of entries filled by the current search (sampled from the first buckets)
+    int hashfull() const {
+        int used = 0;
+        for (int i = 0; i < 250 && i < (int) bucketCount; i++) {
+            for (TTEntry &entry : buckets[i].entries) {
+                U64 data = entry.data.load(std::memory_order_relaxed);
+                used += data && get_tt_age(data) == age;
+            }
+        }
+        return used;
+    }
+};
+
+// transposition table (sized at startup)
+TranspositionTable transpositionTable;
+
+/*********************\
+ ======================
+         Search
+ ======================
+\*********************/
+
+// maximum search ply
+#define MAX_PLY 64
+
+// mate score, scores beyond the bound are mate in n plies
+#define INFINITE_SCORE 32000
+#define MATE_SCORE 31000
+#define MATE_BOUND (MATE_SCORE - MAX_PLY)
+
+// initial aspiration window half width
+#define ASPIRATION_WINDOW 25
+
+// search limits (0 = no limit)
+struct SearchLimits {
+    int depth = 0;
+    U64 nodes = 0ULL;
+    long long movetime = 0;
+
+    // clock time and increment per side in milliseconds, moves to next time control
+    long long time[2] = {0, 0};
+    long long inc[2] = {0, 0};
+    int movestogo = 0;
+
+    // search until stopped (bestmove is held back until stop or ponderhit)
+    bool infinite = false;
+    bool ponder = false;
+};
+
+// time reserved for move transmission and thread start up per move in milliseconds
+#define MOVE_OVERHEAD 30
+
+// default moves left when the time control has no moves to go
+#define DEFAULT_MOVES_TO_GO 30
+
+struct SearchState;
+struct SearchWorker;
+
+// move ordering scores
+#define CAPTURE_SCORE 1000000
+#define BAD_CAPTURE_SCORE (-CAPTURE_SCORE)
+
+// history scores stay within +-MAX_HISTORY (every update is scaled down by the current value)
+#define MAX_HISTORY 16384
+
+// move picker stages, every stage is generated only when the previous one ran out
+enum {
+    stageTTMove, stageGenerateTacticals, stageGoodCaptures, stageKiller1, stageKiller2, stageCounterMove,
+    stageGenerateQuiets, stageQuiets, stageBadCaptures, stageDone
+};
+
+// staged move picker: tt move, good captures by MVV-LVA (SEE >= 0), killers, counter move,
+// quiets by history, captures losing material (SEE < 0)
+// (tacticalOnly picks good captures and promotions only, for quiescence search)
+struct MovePicker {
+    SearchWorker &worker;
+    Move ttMove;
+    Move killers[2];
+    Move counterMove;
+    bool tacticalOnly;
+    int stage;
+
+    // tactical moves are at [0, tacticalEnd), quiets behind them
+    MoveList list;
+    int scores[MAX_MOVES];
+    int index = 0;
+    int tacticalEnd = 0;
+    int badIndex = 0;
+
+    MovePicker(SearchWorker &worker, Move ttMove, int ply, bool tacticalOnly);
+    Move next();
+
+private:
+    // next move of [index, end) with the best score (selection sort step)
+    Move pickBest(int end) {
+        int best = index;
+        for (int i = index + 1; i < end; i++) {
+            if (scores[i] > scores[best]) best = i;
+        }
+
+        std::swap(list.moves[index], list.moves[best]);
+        std::swap(scores[index], scores[best]);
+
+        return list.moves[index++];
+    }
+
+    // tt, killer and counter moves are picked in their own stages already
+    bool alreadyPicked(Move move) const {
+        return move == ttMove || move == killers[0] || move == killers[1] || move == counterMove;
+    }
+};
+
+// per search thread state
+struct SearchWorker {
+    CBoard board;
+
+    // search the thread belongs to
+    SearchState *state = nullptr;
+
+    // thread index, 0 is the main thread
+    int id = 0;
+
+    // node and transposition table counters (only written by the owning thread, read by the main thread)
+    std::atomic<U64> nodes{0ULL};
+    std::atomic<U64> ttProbes{0ULL};
+    std::atomic<U64> ttHits{0ULL};
+
+    // beta cutoffs and cutoffs by the first move searched
+    std::atomic<U64> cutoffs{0ULL};
+    std::atomic<U64> firstMoveCutoffs{0ULL};
+
+    // hot path counters and timers (SEARCH_STATS builds only)
+    SearchStats stats;
+
+    // move ordering heuristics (thread local, threads never write each other's tables)
+    Move killers[MAX_PLY][2];
+    int history[2][64][64];
+
+    // counter moves [piece][target square] of the previous move
+    Move counterMoves[12][64];
+
+    // moves leading from root to ply
+    Move moveStack[MAX_PLY];
+
+    // triangular principal variation table
+    Move pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+};
+
+// search result of main thread
+struct SearchResult {
+    Move bestMove = NO_MOVE;
+    int score = 0;
+    int depth = 0;
+    U64 nodes = 0ULL;
+    long long timeNs = 0;
+};
+
+// state shared by the threads of one search (independent searches can run side by side)
+struct SearchState {
+    // stop flag (set by limits or the user)
+    std::atomic<bool> stopped{false};
+
+    // search runs on the opponent's time until ponderhit
+    std::atomic<bool> pondering{false};
+
+    // limits and start time (start is reset on ponderhit)
+    SearchLimits limits;
+    std::atomic<long long> startNs{0};
+
+    // time budget in milliseconds: no new iteration after the soft limit, stop at the hard limit
+    long long softTime = 0;
+    long long hardTime = 0;
+
+    // workers of running search
+    std::vector<SearchWorker *> workers;
+
+    // transposition table probed and filled by the search (batch workers bring their own)
+    TranspositionTable *tt = &transpositionTable;
+
+    // stats of every finished search (SEARCH_STATS builds only)
+    StatsTotals stats;
+};
+
+// search driven by uci and the command line
+SearchState mainSearch;
+
+// number of lazy smp search threads of the main search (main thread included)
+int searchThreadCount = 1;
+
+// increment counter owned by calling thread (no atomic read-modify-write needed)
+static inline void bumpCounter(std::atomic<U64> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// sum of counter over all workers of search
+static inline U64 sumCounters(const SearchState &search, std::atomic<U64> SearchWorker::*counter) {
+    U64 sum = 0ULL;
+    for (SearchWorker *worker : search.workers) {
+        sum += (worker->*counter).load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+// sum stats of the workers of running search
+StatsTotals collectStats(const SearchState &search) {
+    StatsTotals stats;
+    stats.searches = 1;
+    stats.nodes = sumCounters(search, &SearchWorker::nodes);
+    stats.ttProbes = sumCounters(search, &SearchWorker::ttProbes);
+    stats.ttHits = sumCounters(search, &SearchWorker::ttHits);
+    stats.cutoffs = sumCounters(search, &SearchWorker::cutoffs);
+    stats.searchNs = getTimeNs() - search.startNs;
+
+    for (SearchWorker *worker : search.workers) {
+        const SearchStats &counters = worker->stats;
+
+        stats.qnodes += counters.qnodes.load(std::memory_order_relaxed);
+        stats.ttCollisions += counters.ttCollisions.load(std::memory_order_relaxed);
+        stats.movegenCalls += counters.movegenCalls.load(std::memory_order_relaxed);
+        stats.seeCalls += counters.seeCalls.load(std::memory_order_relaxed);
+        stats.evalCalls += counters.evalCalls.load(std::memory_order_relaxed);
+        for (int i = 0; i < STATS_CUTOFF_SLOTS; i++) {
+            stats.cutoffsByIndex[i] += counters.cutoffsByIndex[i].load(std::memory_order_relaxed);
+        }
+        stats.movegenNs += counters.movegenNs.load(std::memory_order_relaxed);
+        stats.evalNs += counters.evalNs.load(std::memory_order_relaxed);
+    }
+
+    return stats;
+}
+
+// print stats as uci info string
+void printStats(const StatsTotals &stats) {
+    printf("info string stats nodes %llu qnodes %llu ttprobes %llu tthits %llu ttcollisions %llu movegen %llu see %llu "
+           "eval %llu cutoffs %llu byindex", stats.nodes, stats.qnodes, stats.ttProbes, stats.ttHits,
+           stats.ttCollisions, stats.movegenCalls, stats.seeCalls, stats.evalCalls, stats.cutoffs);
+    for (U64 cutoffs : stats.cutoffsByIndex) {
+        printf(" %llu", cutoffs);
+    }
+    printf(" movegentime %.3f evaltime %.3f searchtime %.3f\n", stats.movegenNs / 1e6, stats.evalNs / 1e6,
+           stats.searchNs / 1e6);
+}
+
+// milliseconds elapsed since search start
+static inline long long searchElapsedMs(const SearchState &search) {
+    return (getTimeNs() - search.startNs) / 1000000;
+}
+
+// stop search when node or time limit is reached (checked by the main thread every 2048 nodes)
+static inline void checkLimits(const SearchWorker &worker) {
+    if (worker.id == 0 && (worker.nodes.load(std::memory_order_relaxed) & 2047) == 0) {
+        SearchState &search = *worker.state;
+
+        if ((search.limits.nodes && sumCounters(search, &SearchWorker::nodes) >= search.limits.nodes) ||
+            (search.hardTime && !search.pondering && searchElapsedMs(search) >= search.hardTime)) {
+            search.stopped = true;
+        }
+    }
+}
+
+// mate scores are stored relative to the node, not to the root
+static inline int scoreToTT(int score, int ply) {
+    return score >= MATE_BOUND ? score + ply : score <= -MATE_BOUND ? score - ply : score;
+}
+
+static inline int scoreFromTT(int score, int ply) {
+    return score >= MATE_BOUND ? score - ply : score <= -MATE_BOUND ? score + ply : score;
+}
+
+// counter move slot of the move played before ply (nullptr at root)
+static inline Move *counterMoveSlot(SearchWorker &worker, int ply) {
+    if (!ply) return nullptr;
+
+    int target = get_move_target(worker.moveStack[ply - 1]);
+    return &worker.counterMoves[worker.board.mailbox[target]][target];
+}
+
+MovePicker::MovePicker(SearchWorker &worker, Move ttMove, int ply, bool tacticalOnly)
+        : worker(worker), ttMove(ttMove), tacticalOnly(tacticalOnly) {
+    killers[0] = killers[1] = counterMove = NO_MOVE;
+    list.count = 0;
+
+    if (!tacticalOnly) {
+        killers[0] = worker.killers[ply][0];
+        killers[1] = worker.killers[ply][1];
+
+        Move *slot = counterMoveSlot(worker, ply);
+        if (slot) counterMove = *slot;
+    }
+
+    // moves from other positions must be checked before they are played
+    if (this->ttMove != NO_MOVE && !(isPseudoLegal(worker.board, ttMove) && isLegal(worker.board, ttMove))) {
+        this->ttMove = NO_MOVE;
+    }
+
+    stage = this->ttMove != NO_MOVE ? stageTTMove : stageGenerateTacticals;
+}
+
+// next move in ordering, NO_MOVE when all moves are picked
+Move MovePicker::next() {
+    CBoard &board = worker.board;
+
+    switch (stage) {
+        case stageTTMove:
+            stage++;
+            return ttMove;
+
+        case stageGenerateTacticals:
+            appendMoves<tacticalMoves>(board, list);
+            tacticalEnd = list.count;
+
+            // MVV-LVA, taking an equal or bigger piece never loses material, only other captures need SEE
+            for (int i = 0; i < tacticalEnd; i++) {
+                Move move = list.moves[i];
+                int attacker = get_piece_type(board.mailbox[get_move_source(move)]);
+                int victim = !is_capture(move) ? NO_PIECE :
+                             get_move_flags(move) == enPassantCapture ? pawn :
+                             get_piece_type(board.mailbox[get_move_target(move)]);
+
+                if (victim == NO_PIECE) {
+                    scores[i] = CAPTURE_SCORE + seeValue[get_move_promoted(move)];
+                }
+                else {
+                    bool good = seeValue[victim] >= seeValue[attacker] || see(board, move) >= 0;
+                    scores[i] = (good ? CAPTURE_SCORE : BAD_CAPTURE_SCORE) + seeValue[victim] * 8 - attacker;
+                }
+            }
+
+            stage++;
+            /* fall through */
+
+        case stageGoodCaptures:
+            while (index < tacticalEnd) {
+                // remaining captures all lose material
+                Move move = pickBest(tacticalEnd);
+                if (scores[index - 1] < CAPTURE_SCORE) {
+                    index--;
+                    break;
+                }
+                if (move != ttMove) return move;
+            }
+            badIndex = index;
+
+            // quiescence search stops here (check evasions use the full picker)
+            if (tacticalOnly) {
+                stage = stageDone;
+                return NO_MOVE;
+            }
+
+            stage++;
+            /* fall through */
+
+        case stageKiller1:
+        case stageKiller2:
+        case stageCounterMove:
+            // killers and counter move are quiet moves of sibling nodes, played when legal here
+            while (stage <= stageCounterMove) {
+                Move &move = stage == stageCounterMove ? counterMove : killers[stage - stageKiller1];
+                bool duplicate = move == ttMove || (stage > stageKiller1 && move == killers[0]) ||
+                                 (stage == stageCounterMove && move == killers[1]);
+                stage++;
+
+                // skipped moves are cleared, quiets must not skip them (duplicates are skipped by their first copy)
+                if (move == NO_MOVE || duplicate || is_capture(move) || is_promotion(move) ||
+                    !isPseudoLegal(board, move) || !isLegal(board, move)) {
+                    move = NO_MOVE;
+                    continue;
+                }
+
+                return move;
+            }
+            /* fall through */
+
+        case stageGenerateQuiets:
+            appendMoves<quietMoves>(board, list);
+            index = tacticalEnd;
+
+            for (int i = tacticalEnd; i < list.count; i++) {
+                Move move = list.moves[i];
+                scores[i] = worker.history[board.side][get_move_source(move)][get_move_target(move)];
+            }
+
+            stage = stageQuiets;
+            /* fall through */
+
+        case stageQuiets:
+            while (index < list.count) {
+                Move move = pickBest(list.count);
+                if (!alreadyPicked(move)) return move;
+            }
+
+            index = badIndex;
+            stage++;
+            /* fall through */
+
+        case stageBadCaptures:
+            while (index < tacticalEnd) {
+                Move move = pickBest(tacticalEnd);
+                if (move != ttMove) return move;
+            }
+
+            stage++;
+            /* fall through */
+
+        default:
+            return NO_MOVE;
+    }
+}
+
+// history update with gravity, scores saturate at +-MAX_HISTORY
+static inline void updateHistory(int &entry, int bonus) {
+    entry += bonus - entry * abs(bonus) / MAX_HISTORY;
+}
+
+// quiescence search, resolves captures and promotions (and check evasions) before evaluating
+int quiescence(SearchWorker &worker, int alpha, int beta, int ply) {
+    CBoard &board = worker.board;
+
+    bumpCounter(worker.nodes);
+    stats_add(qnodes, 1);
+    checkLimits(worker);
+    if (worker.state->stopped) return 0;
+
+    bool checked = inCheck(board);
+
+    if (ply >= MAX_PLY - 1) {
+        return checked ? 0 : evaluate(board);
+    }
+
+    // stand pat
+    if (!checked) {
+        int eval = evaluate(board);
+        if (eval >= beta) return eval;
+        if (eval > alpha) alpha = eval;
+    }
+
+    // losing captures are pruned without making them, every evasion is searched in check
+    MovePicker picker(worker, NO_MOVE, ply, !checked);
+    int moveCount = 0;
+    Move move;
+
+    while ((move = picker.next()) != NO_MOVE) {
+        moveCount++;
+        worker.moveStack[ply] = move;
+
+        board.makeMove(move);
+        int score = -quiescence(worker, -beta, -alpha, ply + 1);
+        board.unmakeMove(move);
+
+        if (worker.state->stopped) return 0;
+
+        if (score > alpha) {
+            if (score >= beta) return score;
+            alpha = score;
+        }
+    }
+
+    if (checked && !moveCount) {
+        return -MATE_SCORE + ply;
+    }
+
+    return alpha;
+}
+
+// negamax alpha-beta search
+int negamax(SearchWorker &worker, int alpha, int beta, int depth, int ply) {
+    CBoard &board = worker.board;
+    worker.pvLength[ply] = ply;
+
+    // draw by fifty move rule or repetition
+    if (ply && (board.halfmoveClock >= 100 || board.isRepetition())) {
+        return 0;
+    }
+
+    // drawn king and pawn versus king endings need no search
+    if (ply && isKpk(board) && !kpkProbe(board)) {
+        return 0;
+    }
+
+    bool checked = inCheck(board);
+
+    // check extension
+    if (checked) depth++;
+
+    if (depth <= 0) {
+        return quiescence(worker, alpha, beta, ply);
+    }
+
+    bumpCounter(worker.nodes);
+    checkLimits(worker);
+    if (worker.state->stopped) return 0;
+
+    if (ply >= MAX_PLY - 1) {
+        return evaluate(board);
+    }
+
+    // transposition table lookup (no cutoffs on pv nodes to keep the pv intact)
+    bool pvNode = beta - alpha > 1;
+    Move ttMove = NO_MOVE;
+    U64 ttData;
+
+    bumpCounter(worker.ttProbes);
+    if (worker.state->tt->probe(board.hashKey, ttData)) {
+        bumpCounter(worker.ttHits);
+        ttMove = get_tt_move(ttData);
+
+        if (!pvNode && ply && get_tt_depth(ttData) >= depth) {
+            int score = scoreFromTT(get_tt_score(ttData), ply);
+            int bound = get_tt_bound(ttData);
+
+            if (bound == hashExact || (bound == hashAlpha && score <= alpha) || (bound == hashBeta && score >= beta)) {
+                return score;
+            }
+        }
+    }
+
+    MovePicker picker(worker, ttMove, ply, false);
+    int bestScore = -INFINITE_SCORE;
+    Move bestMove = NO_MOVE;
+    int bound = hashAlpha;
+
+    // quiet moves searched so far (their history is lowered when a later move cuts off)
+    Move quiets[MAX_MOVES];
+    int quietCount = 0;
+    int moveCount = 0;
+    Move move;
+
+    while ((move = picker.next()) != NO_MOVE) {
+        moveCount++;
+        worker.moveStack[ply] = move;
+
+        board.makeMove(move);
+        int score = -negamax(worker, -beta, -alpha, depth - 1, ply + 1);
+        board.unmakeMove(move);
+
+        if (worker.state->stopped) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = move;
+        }
+
+        if (score > alpha) {
+            alpha = score;
+            bound = hashExact;
+
+            // update principal variation
+            worker.pvTable[ply][ply] = move;
+            for (int next = ply + 1; next < worker.pvLength[ply + 1]; next++) {
+                worker.pvTable[ply][next] = worker.pvTable[ply + 1][next];
+            }
+            worker.pvLength[ply] = worker.pvLength[ply + 1];
+
+            if (score >= beta) {
+                bound = hashBeta;
+
+                bumpCounter(worker.cutoffs);
+                if (moveCount == 1) bumpCounter(worker.firstMoveCutoffs);
+                stats_add(cutoffsByIndex[std::min(moveCount, STATS_CUTOFF_SLOTS) - 1], 1);
+
+                // quiet move cutoffs feed the killer, counter move and history tables
+                if (!is_capture(move) && !is_promotion(move)) {
+                    if (worker.killers[ply][0] != move) {
+                        worker.killers[ply][1] = worker.killers[ply][0];
+                        worker.killers[ply][0] = move;
+                    }
+
+                    Move *slot = counterMoveSlot(worker, ply);
+                    if (slot) *slot = move;
+
+                    int bonus = std::min(depth * depth, MAX_HISTORY / 4);
+                    updateHistory(worker.history[board.side][get_move_source(move)][get_move_target(move)], bonus);
+                    for (int i = 0; i < quietCount; i++) {
+                        updateHistory(worker.history[board.side][get_move_source(quiets[i])][get_move_target(quiets[i])],
+                                      -bonus);
+                    }
+                }
+                break;
+            }
+        }
+
+        if (!is_capture(move) && !is_promotion(move)) {
+            quiets[quietCount++] = move;
+        }
+    }
+
+    // checkmate or stalemate
+    if (!moveCount) {
+        return checked ? -MATE_SCORE + ply : 0;
+    }
+
+    worker.state->tt->store(board.hashKey, bestMove, scoreToTT(bestScore, ply), depth, bound);
+
+    return bestScore;
+}
+
+// print score in UCI format
+static inline void printScore(int score) {
+    if (score >= MATE_BOUND) printf("score mate %d", (MATE_SCORE - score + 1) / 2);
+    else if (score <= -MATE_BOUND) printf("score mate %d", -(MATE_SCORE + score) / 2);
+    else printf("score cp %d", score);
+}
+
+// iterative deepening search with aspiration windows
+// (the main thread prints an info line per iteration with nps, effective branching factor and tt hit rate,
+// helper threads start one ply deeper on odd ids so threads spread over different depths)
+void iterativeDeepening(SearchWorker &worker, SearchResult &result, bool print) {
+    char moveString[6];
+    SearchState &search = *worker.state;
+
+    int maxDepth = search.limits.depth > 0 && search.limits.depth < MAX_PLY ? search.limits.depth : MAX_PLY - 1;
+    int score = 0;
+    U64 lastIterationNodes = 0ULL;
+
+    // hot path stats of this thread go to the worker
+    threadStats = &worker.stats;
+
+    for (int depth = 1 + (worker.id & 1); depth <= maxDepth; depth++) {
+        U64 iterationStartNodes = sumCounters(search, &SearchWorker::nodes);
+
+        // search narrow window around previous score first, widen on failure
+        int window = ASPIRATION_WINDOW;
+        int alpha = depth >= 4 ? score - window : -INFINITE_SCORE;
+        int beta = depth >= 4 ? score + window : INFINITE_SCORE;
+
+        while (true) {
+            int value = negamax(worker, alpha, beta, depth, 0);
+            if (search.stopped) break;
+
+            window *= 2;
+            if (value <= alpha) {
+                alpha = std::max(value - window, -INFINITE_SCORE);
+            }
+            else if (value >= beta) {
+                beta = std::min(value + window, INFINITE_SCORE);
+            }
+            else {
+                score = value;
+                break;
+            }
+        }
+
+        // unfinished iteration, keep best move of the last complete one
+        if (search.stopped && result.bestMove != NO_MOVE) break;
+        if (worker.pvLength[0]) result.bestMove = worker.pvTable[0][0];
+        if (search.stopped) break;
+
+        result.score = score;
+        result.depth = depth;
+
+        if (print) {
+            long long elapsed = getTimeNs() - search.startNs;
+            U64 nodes = sumCounters(search, &SearchWorker::nodes);
+            U64 iterationNodes = nodes - iterationStartNodes;
+            U64 ttProbes = sumCounters(search, &SearchWorker::ttProbes);
+
+            printf("info depth %d ", depth);
+            printScore(score);
+            printf(" nodes %llu nps %.0f time %lld hashfull %d pv", nodes, elapsed ? nodes * 1e9 / elapsed : 0.0,
+                   elapsed / 1000000, search.tt->hashfull());
+            for (int i = 0; i < worker.pvLength[0]; i++) {
+                printf(" %s", moveToString(worker.pvTable[0][i], moveString));
+            }
+            printf("\n");
+
+            U64 cutoffs = sumCounters(search, &SearchWorker::cutoffs);
+
+            printf("info string ebf %.2f tthit %.2f%% fmc %.2f%%\n",
+                   lastIterationNodes ? (double) iterationNodes / lastIterationNodes : 0.0,
+                   ttProbes ? sumCounters(search, &SearchWorker::ttHits) * 100.0 / ttProbes : 0.0,
+                   cutoffs ? sumCounters(search, &SearchWorker::firstMoveCutoffs) * 100.0 / cutoffs : 0.0);
+            fflush(stdout);
+
+            lastIterationNodes = iterationNodes;
+        }
+
+        // stop on found mate
+        if (score >= MATE_BOUND || score <= -MATE_BOUND) break;
+
+        // next iteration would most likely not finish in time
+        if (worker.id == 0 && search.softTime && !search.pondering && searchElapsedMs(search) >= search.softTime) break;
+    }
+
+    threadStats = nullptr;
+}
+
+// split clock time into soft and hard time budget of side to move
+void initTimeManagement(SearchState &search, const SearchLimits &limits, int side) {
+    search.softTime = search.hardTime = 0;
+
+    if (limits.movetime) {
+        search.softTime = search.hardTime = limits.movetime;
+    }
+    else if (limits.time[side]) {
+        long long time = std::max(limits.time[side] - MOVE_OVERHEAD, 1LL);
+        int movesToGo = limits.movestogo > 0 ? limits.movestogo : DEFAULT_MOVES_TO_GO;
+
+        // share of remaining time plus most of the increment, never more than the clock allows
+        long long optimum = std::min(time / movesToGo + limits.inc[side] * 3 / 4, time);
+
+        search.softTime = std::max(optimum / 2, 1LL);
+        search.hardTime = std::min(optimum * 3, time * 3 / 4 + 1);
+    }
+}
+
+// lazy smp search: every thread searches the root on its own board, sharing the search's transposition table
+// (the caller clears search.stopped and sets search.pondering, so a stop sent right after go is not lost)
+// returns result of the main thread
+SearchResult searchPosition(SearchState &search, const CBoard &root, const SearchLimits &limits, int threadCount,
+                            bool print = true) {
+    char moveString[6];
+    SearchResult result;
+
+    search.limits = limits;
+    search.startNs = getTimeNs();
+    initTimeManagement(search, limits, root.side);
+    search.tt->newSearch();
+
+    threadCount = threadCount > 0 ? threadCount : 1;
+    for (int id = 0; id < threadCount; id++) {
+        SearchWorker *worker = new SearchWorker();
+        worker->board = root;
+        worker->state = &search;
+        worker->id = id;
+        memset(worker->killers, 0, sizeof(worker->killers));
+        memset(worker->history, 0, sizeof(worker->history));
+        memset(worker->counterMoves, 0, sizeof(worker->counterMoves));
+        search.workers.push_back(worker);
+    }
+
+    // helper results are discarded
+    std::vector<SearchResult> helperResults(threadCount);
+    std::vector<std::thread> helpers;
+    for (int id = 1; id < threadCount; id++) {
+        helpers.emplace_back(iterativeDeepening, std::ref(*search.workers[id]), std::ref(helperResults[id]), false);
+    }
+
+    iterativeDeepening(*search.workers[0], result, print);
+
+    // bestmove of infinite and ponder searches must wait for stop or ponderhit
+    while ((search.limits.infinite || search.pondering) && !search.stopped) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // main thread is done, stop helpers
+    search.stopped = true;
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    // stopped before the first iteration finished, any legal move beats none
+    if (result.bestMove == NO_MOVE) {
+        MoveList list;
+        generateMoves(search.workers[0]->board, list);
+        if (list.count) result.bestMove = list.moves[0];
+    }
+
+    result.nodes = sumCounters(search, &SearchWorker::nodes);
+    result.timeNs = getTimeNs() - search.startNs;
+
+#if SEARCH_STATS_ENABLED
+    StatsTotals stats = collectStats(search);
+    search.stats += stats;
+    if (print) printStats(stats);
+#endif
+
+    for (SearchWorker *worker : search.workers) {
+        delete worker;
+    }
+    search.workers.clear();
+
+    if (print) {
+        printf("bestmove %s\n", result.bestMove != NO_MOVE ? moveToString(result.bestMove, moveString) : "0000");
+        fflush(stdout);
+    }
+
+    return result;
+}
+
+/*********************\
+ ======================
+      Opening Book
+ ======================
+\*********************/
+
+// polyglot random table: 768 piece squares, 4 castling rights, 8 en passant files, white to move
+#define POLYGLOT_RANDOM_COUNT 781
+#define POLYGLOT_CASTLING_OFFSET 768
+#define POLYGLOT_EN_PASSANT_OFFSET 772
+#define POLYGLOT_TURN_OFFSET 780
+
+// standard polyglot Random64 numbers, keys of books written by other tools depend on every one of them
+constexpr U64 polyglotRandom[POLYGLOT_RANDOM_COUNT] = {
+        0x9d39247e33776d41ULL, 0x2af7398005aaa5c7ULL, 0x44db015024623547ULL, 0x9c15f73e62a76ae2ULL,
+        0x75834465489c0c89ULL, 0x3290ac3a203001bfULL, 0x0fbbad1f61042279ULL, 0xe83a908ff2fb60caULL,
+        0x0d7e765d58755c10ULL, 0x1a083822ceafe02dULL, 0x9605d5f0e25ec3b0ULL, 0xd021ff5cd13a2ed5ULL,
+        0x40bdf15d4a672e32ULL, 0x011355146fd56395ULL, 0x5db4832046f3d9e5ULL, 0x239f8b2d7ff719ccULL,
+        0x05d1a1ae85b49aa1ULL, 0x679f848f6e8fc971ULL, 0x7449bbff801fed0bULL, 0x7d11cdb1c3b7adf0ULL,
+        0x82c7709e781eb7ccULL, 0xf3218f1c9510786cULL, 0x331478f3af51bbe6ULL, 0x4bb38de5e7219443ULL,
+        0xaa649c6ebcfd50fcULL, 0x8dbd98a352afd40bULL, 0x87d2074b81d79217ULL, 0x19f3c751d3e92ae1ULL,
+        0xb4ab30f062b19abfULL, 0x7b0500ac42047ac4ULL, 0xc9452ca81a09d85dULL, 0x24aa6c514da27500ULL,
+        0x4c9f34427501b447ULL, 0x14a68fd73c910841ULL, 0xa71b9b83461cbd93ULL, 0x03488b95b0f1850fULL,
+        0x637b2b34ff93c040ULL, 0x09d1bc9a3dd90a94ULL, 0x3575668334a1dd3bULL, 0x735e2b97a4c45a23ULL,
+        0x18727070f1bd400bULL, 0x1fcbacd259bf02e7ULL, 0xd310a7c2ce9b6555ULL, 0xbf983fe0fe5d8244ULL,
+        0x9f74d14f7454a824ULL, 0x51ebdc4ab9ba3035ULL, 0x5c82c505db9ab0faULL, 0xfcf7fe8a3430b241ULL,
+        0x3253a729b9ba3ddeULL, 0x8c74c368081b3075ULL, 0xb9bc6c87167c33e7ULL, 0x7ef48f2b83024e20ULL,
+        0x11d505d4c351bd7fULL, 0x6568fca92c76a243ULL, 0x4de0b0f40f32a7b8ULL, 0x96d693460cc37e5dULL,
+        0x42e240cb63689f2fULL, 0x6d2bdcdae2919661ULL, 0x42880b0236e4d951ULL, 0x5f0f4a5898171bb6ULL,
+        0x39f890f579f92f88ULL, 0x93c5b5f47356388bULL, 0x63dc359d8d231b78ULL, 0xec16ca8aea98ad76ULL,
+        0x5355f900c2a82dc7ULL, 0x07fb9f855a997142ULL, 0x5093417aa8a7ed5eULL, 0x7bcbc38da25a7f3cULL,
+        0x19fc8a768cf4b6d4ULL, 0x637a7780decfc0d9ULL, 0x8249a47aee0e41f7ULL, 0x79ad695501e7d1e8ULL,
+        0x14acbaf4777d5776ULL, 0xf145b6beccdea195ULL, 0xdabf2ac8201752fcULL, 0x24c3c94df9c8d3f6ULL,
+        0xbb6e2924f03912eaULL, 0x0ce26c0b95c980d9ULL, 0xa49cd132bfbf7cc4ULL, 0xe99d662af4243939ULL,
+        0x27e6ad7891165c3fULL, 0x8535f040b9744ff1ULL, 0x54b3f4fa5f40d873ULL, 0x72b12c32127fed2bULL,
+        0xee954d3c7b411f47ULL, 0x9a85ac909a24eaa1ULL, 0x70ac4cd9f04f21f5ULL, 0xf9b89d3e99a075c2ULL,
+        0x87b3e2b2b5c907b1ULL, 0xa366e5b8c54f48b8ULL, 0xae4a9346cc3f7cf2ULL, 0x1920c04d47267bbdULL,
+        0x87bf02c6b49e2ae9ULL, 0x092237ac237f3859ULL, 0xff07f64ef8ed14d0ULL, 0x8de8dca9f03cc54eULL,
+        0x9c1633264db49c89ULL, 0xb3f22c3d0b0b38edULL, 0x390e5fb44d01144bULL, 0x5bfea5b4712768e9ULL,
+        0x1e1032911fa78984ULL, 0x9a74acb964e78cb3ULL, 0x4f80f7a035dafb04ULL, 0x6304d09a0b3738c4ULL,
+        0x2171e64683023a08ULL, 0x5b9b63eb9ceff80cULL, 0x506aacf489889342ULL, 0x1881afc9a3a701d6ULL,
+        0x6503080440750644ULL, 0xdfd395339cdbf4a7ULL, 0xef927dbcf00c20f2ULL, 0x7b32f7d1e03680ecULL,
+        0xb9fd7620e7316243ULL, 0x05a7e8a57db91b77ULL, 0xb5889c6e15630a75ULL, 0x4a750a09ce9573f7ULL,
+        0xcf464cec899a2f8aULL, 0xf538639ce705b824ULL, 0x3c79a0ff5580ef7fULL, 0xede6c87f8477609dULL,
+        0x799e81f05bc93f31ULL, 0x86536b8cf3428a8cULL, 0x97d7374c60087b73ULL, 0xa246637cff328532ULL,
+        0x043fcae60cc0eba0ULL, 0x920e449535dd359eULL, 0x70eb093b15b290ccULL, 0x73a1921916591cbdULL,
+        0x56436c9fe1a1aa8dULL, 0xefac4b70633b8f81ULL, 0xbb215798d45df7afULL, 0x45f20042f24f1768ULL,
+        0x930f80f4e8eb7462ULL, 0xff6712ffcfd75ea1ULL, 0xae623fd67468aa70ULL, 0xdd2c5bc84bc8d8fcULL,
+        0x7eed120d54cf2dd9ULL, 0x22fe545401165f1cULL, 0xc91800e98fb99929ULL, 0x808bd68e6ac10365ULL,
+        0xdec468145b7605f6ULL, 0x1bede3a3aef53302ULL, 0x43539603d6c55602ULL, 0xaa969b5c691ccb7aULL,
+        0xa87832d392efee56ULL, 0x65942c7b3c7e11aeULL, 0xded2d633cad004f6ULL, 0x21f08570f420e565ULL,
+        0xb415938d7da94e3cULL, 0x91b859e59ecb6350ULL, 0x10cff333e0ed804aULL, 0x28aed140be0bb7ddULL,
+        0xc5cc1d89724fa456ULL, 0x5648f680f11a2741ULL, 0x2d255069f0b7dab3ULL, 0x9bc5a38ef729abd4ULL,
+        0xef2f054308f6a2bcULL, 0xaf2042f5cc5c2858ULL, 0x480412bab7f5be2aULL, 0xaef3af4a563dfe43ULL,
+        0x19afe59ae451497fULL, 0x52593803dff1e840ULL, 0xf4f076e65f2ce6f0ULL, 0x11379625747d5af3ULL,
+        0xbce5d2248682c115ULL, 0x9da4243de836994fULL, 0x066f70b33fe09017ULL, 0x4dc4de189b671a1cULL,
+        0x51039ab7712457c3ULL, 0xc07a3f80c31fb4b4ULL, 0xb46ee9c5e64a6e7cULL, 0xb3819a42abe61c87ULL,
+        0x21a007933a522a20ULL, 0x2df16f761598aa4fULL, 0x763c4a1371b368fdULL, 0xf793c46702e086a0ULL,
+        0xd7288e012aeb8d31ULL, 0xde336a2a4bc1c44bULL, 0x0bf692b38d079f23ULL, 0x2c604a7a177326b3ULL,
+        0x4850e73e03eb6064ULL, 0xcfc447f1e53c8e1bULL, 0xb05ca3f564268d99ULL, 0x9ae182c8bc9474e8ULL,
+        0xa4fc4bd4fc5558caULL, 0xe755178d58fc4e76ULL, 0x69b97db1a4c03dfeULL, 0xf9b5b7c4acc67c96ULL,
+        0xfc6a82d64b8655fbULL, 0x9c684cb6c4d24417ULL, 0x8ec97d2917456ed0ULL, 0x6703df9d2924e97eULL,
+        0xc547f57e42a7444eULL, 0x78e37644e7cad29eULL, 0xfe9a44e9362f05faULL, 0x08bd35cc38336615ULL,
+        0x9315e5eb3a129aceULL, 0x94061b871e04df75ULL, 0xdf1d9f9d784ba010ULL, 0x3bba57b68871b59dULL,
+        0xd2b7adeeded1f73fULL, 0xf7a255d83bc373f8ULL, 0xd7f4f2448c0ceb81ULL, 0xd95be88cd210ffa7ULL,
+        0x336f52f8ff4728e7ULL, 0xa74049dac312ac71ULL, 0xa2f61bb6e437fdb5ULL, 0x4f2a5cb07f6a35b3ULL,
+        0x87d380bda5bf7859ULL, 0x16b9f7e06c453a21ULL, 0x7ba2484c8a0fd54eULL, 0xf3a678cad9a2e38cULL,
+        0x39b0bf7dde437ba2ULL, 0xfcaf55c1bf8a4424ULL, 0x18fcf680573fa594ULL, 0x4c0563b89f495ac3ULL,
+        0x40e087931a00930dULL, 0x8cffa9412eb642c1ULL, 0x68ca39053261169fULL, 0x7a1ee967d27579e2ULL,
+        0x9d1d60e5076f5b6fULL, 0x3810e399b6f65ba2ULL, 0x32095b6d4ab5f9b1ULL, 0x35cab62109dd038aULL,
+        0xa90b24499fcfafb1ULL, 0x77a225a07cc2c6bdULL, 0x513e5e634c70e331ULL, 0x4361c0ca3f692f12ULL,
+        0xd941aca44b20a45bULL, 0x528f7c8602c5807bULL, 0x52ab92beb9613989ULL, 0x9d1dfa2efc557f73ULL,
+        0x722ff175f572c348ULL, 0x1d1260a51107fe97ULL, 0x7a249a57ec0c9ba2ULL, 0x04208fe9e8f7f2d6ULL,
+        0x5a110c6058b920a0ULL, 0x0cd9a497658a5698ULL, 0x56fd23c8f9715a4cULL, 0x284c847b9d887aaeULL,
+        0x04feabfbbdb619cbULL, 0x742e1e651c60ba83ULL, 0x9a9632e65904ad3cULL, 0x881b82a13b51b9e2ULL,
+        0x506e6744cd974924ULL, 0xb0183db56ffc6a79ULL, 0x0ed9b915c66ed37eULL, 0x5e11e86d5873d484ULL,
+        0xf678647e3519ac6eULL, 0x1b85d488d0f20cc5ULL, 0xdab9fe6525d89021ULL, 0x0d151d86adb73615ULL,
+        0xa865a54edcc0f019ULL, 0x93c42566aef98ffbULL, 0x99e7afeabe000731ULL, 0x48cbff086ddf285aULL,
+        0x7f9b6af1ebf78bafULL, 0x58627e1a149bba21ULL, 0x2cd16e2abd791e33ULL, 0xd363eff5f0977996ULL,
+        0x0ce2a38c344a6eedULL, 0x1a804aadb9cfa741ULL, 0x907f30421d78c5deULL, 0x501f65edb3034d07ULL,
+        0x37624ae5a48fa6e9ULL, 0x957baf61700cff4eULL, 0x3a6c27934e31188aULL, 0xd49503536abca345ULL,
+        0x088e049589c432e0ULL, 0xf943aee7febf21b8ULL, 0x6c3b8e3e336139d3ULL, 0x364f6ffa464ee52eULL,
+        0xd60f6dcedc314222ULL, 0x56963b0dca418fc0ULL, 0x16f50edf91e513afULL, 0xef1955914b609f93ULL,
+        0x565601c0364e3228ULL, 0xecb53939887e8175ULL, 0xbac7a9a18531294bULL, 0xb344c470397bba52ULL,
+        0x65d34954daf3cebdULL, 0xb4b81b3fa97511e2ULL, 0xb422061193d6f6a7ULL, 0x071582401c38434dULL,
+        0x7a13f18bbedc4ff5ULL, 0xbc4097b116c524d2ULL, 0x59b97885e2f2ea28ULL, 0x99170a5dc3115544ULL,
+        0x6f423357e7c6a9f9ULL, 0x325928ee6e6f8794ULL, 0xd0e4366228b03343ULL, 0x565c31f7de89ea27ULL,
+        0x30f5611484119414ULL, 0xd873db391292ed4fULL, 0x7bd94e1d8e17debcULL, 0xc7d9f16864a76e94ULL,
+        0x947ae053ee56e63cULL, 0xc8c93882f9475f5fULL, 0x3a9bf55ba91f81caULL, 0xd9a11fbb3d9808e4ULL,
+        0x0fd22063edc29fcaULL, 0xb3f256d8aca0b0b9ULL, 0xb03031a8b4516e84ULL, 0x35dd37d5871448afULL,
+        0xe9f6082b05542e4eULL, 0xebfafa33d7254b59ULL, 0x9255abb50d532280ULL, 0xb9ab4ce57f2d34f3ULL,
+        0x693501d628297551ULL, 0xc62c58f97dd949bfULL, 0xcd454f8f19c5126aULL, 0xbbe83f4ecc2bdecbULL,
+        0xdc842b7e2819e230ULL, 0xba89142e007503b8ULL, 0xa3bc941d0a5061cbULL, 0xe9f6760e32cd8021ULL,
+        0x09c7e552bc76492fULL, 0x852f54934da55cc9ULL, 0x8107fccf064fcf56ULL, 0x098954d51fff6580ULL,
+        0x23b70edb1955c4bfULL, 0xc330de426430f69dULL, 0x4715ed43e8a45c0aULL, 0xa8d7e4dab780a08dULL,
+        0x0572b974f03ce0bbULL, 0xb57d2e985e1419c7ULL, 0xe8d9ecbe2cf3d73fULL, 0x2fe4b17170e59750ULL,
+        0x11317ba87905e790ULL, 0x7fbf21ec8a1f45ecULL, 0x1725cabfcb045b00ULL, 0x964e915cd5e2b207ULL,
+        0x3e2b8bcbf016d66dULL, 0xbe7444e39328a0acULL, 0xf85b2b4fbcde44b7ULL, 0x49353fea39ba63b1ULL,
+        0x1dd01aafcd53486aULL, 0x1fca8a92fd719f85ULL, 0xfc7c95d827357afaULL, 0x18a6a990c8b35ebdULL,
+        0xcccb7005c6b9c28dULL, 0x3bdbb92c43b17f26ULL, 0xaa70b5b4f89695a2ULL, 0xe94c39a54a98307fULL,
+        0xb7a0b174cff6f36eULL, 0xd4dba84729af48adULL, 0x2e18bc1ad9704a68ULL, 0x2de0966daf2f8b1cULL,
+        0xb9c11d5b1e43a07eULL, 0x64972d68dee33360ULL, 0x94628d38d0c20584ULL, 0xdbc0d2b6ab90a559ULL,
+        0xd2733c4335c6a72fULL, 0x7e75d99d94a70f4dULL, 0x6ced1983376fa72bULL, 0x97fcaacbf030bc24ULL,
+        0x7b77497b32503b12ULL, 0x8547eddfb81ccb94ULL, 0x79999cdff70902cbULL, 0xcffe1939438e9b24ULL,
+        0x829626e3892d95d7ULL, 0x92fae24291f2b3f1ULL, 0x63e22c147b9c3403ULL, 0xc678b6d860284a1cULL,
+        0x5873888850659ae7ULL, 0x0981dcd296a8736dULL, 0x9f65789a6509a440ULL, 0x9ff38fed72e9052fULL,
+        0xe479ee5b9930578cULL, 0xe7f28ecd2d49eecdULL, 0x56c074a581ea17feULL, 0x5544f7d774b14aefULL,
+        0x7b3f0195fc6f290fULL, 0x12153635b2c0cf57ULL, 0x7f5126dbba5e0ca7ULL, 0x7a76956c3eafb413ULL,
+        0x3d5774a11d31ab39ULL, 0x8a1b083821f40cb4ULL, 0x7b4a38e32537df62ULL, 0x950113646d1d6e03ULL,
+        0x4da8979a0041e8a9ULL, 0x3bc36e078f7515d7ULL, 0x5d0a12f27ad310d1ULL, 0x7f9d1a2e1ebe1327ULL,
+        0xda3a361b1c5157b1ULL, 0xdcdd7d20903d0c25ULL, 0x36833336d068f707ULL, 0xce68341f79893389ULL,
+        0xab9090168dd05f34ULL, 0x43954b3252dc25e5ULL, 0xb438c2b67f98e5e9ULL, 0x10dcd78e3851a492ULL,
+        0xdbc27ab5447822bfULL, 0x9b3cdb65f82ca382ULL, 0xb67b7896167b4c84ULL, 0xbfced1b0048eac50ULL,
+        0xa9119b60369ffebdULL, 0x1fff7ac80904bf45ULL, 0xac12fb171817eee7ULL, 0xaf08da9177dda93dULL,
+        0x1b0cab936e65c744ULL, 0xb559eb1d04e5e932ULL, 0xc37b45b3f8d6f2baULL, 0xc3a9dc228caac9e9ULL,
+        0xf3b8b6675a6507ffULL, 0x9fc477de4ed681daULL, 0x67378d8eccef96cbULL, 0x6dd856d94d259236ULL,
+        0xa319ce15b0b4db31ULL, 0x073973751f12dd5eULL, 0x8a8e849eb32781a5ULL, 0xe1925c71285279f5ULL,
+        0x74c04bf1790c0efeULL, 0x4dda48153c94938aULL, 0x9d266d6a1cc0542cULL, 0x7440fb816508c4feULL,
+        0x13328503df48229fULL, 0xd6bf7baee43cac40ULL, 0x4838d65f6ef6748fULL, 0x1e152328f3318deaULL,
+        0x8f8419a348f296bfULL, 0x72c8834a5957b511ULL, 0xd7a023a73260b45cULL, 0x94ebc8abcfb56daeULL,
+        0x9fc10d0f989993e0ULL, 0xde68a2355b93cae6ULL, 0xa44cfe79ae538bbeULL, 0x9d1d84fcce371425ULL,
+        0x51d2b1ab2ddfb636ULL, 0x2fd7e4b9e72cd38cULL, 0x65ca5b96b7552210ULL, 0xdd69a0d8ab3b546dULL,
+        0x604d51b25fbf70e2ULL, 0x73aa8a564fb7ac9eULL, 0x1a8c1e992b941148ULL, 0xaac40a2703d9bea0ULL,
+        0x764dbeae7fa4f3a6ULL, 0x1e99b96e70a9be8bULL, 0x2c5e9deb57ef4743ULL, 0x3a938fee32d29981ULL,
+        0x26e6db8ffdf5adfeULL, 0x469356c504ec9f9dULL, 0xc8763c5b08d1908cULL, 0x3f6c6af859d80055ULL,
+        0x7f7cc39420a3a545ULL, 0x9bfb227ebdf4c5ceULL, 0x89039d79d6fc5c5cULL, 0x8fe88b57305e2ab6ULL,
+        0xa09e8c8c35ab96deULL, 0xfa7e393983325753ULL, 0xd6b6d0ecc617c699ULL, 0xdfea21ea9e7557e3ULL,
+        0xb67c1fa481680af8ULL, 0xca1e3785a9e724e5ULL, 0x1cfc8bed0d681639ULL, 0xd18d8549d140caeaULL,
+        0x4ed0fe7e9dc91335ULL, 0xe4dbf0634473f5d2ULL, 0x1761f93a44d5aefeULL, 0x53898e4c3910da55ULL,
+        0x734de8181f6ec39aULL, 0x2680b122baa28d97ULL, 0x298af231c85bafabULL, 0x7983eed3740847d5ULL,
+        0x66c1a2a1a60cd889ULL, 0x9e17e49642a3e4c1ULL, 0xedb454e7badc0805ULL, 0x50b704cab602c329ULL,
+        0x4cc317fb9cddd023ULL, 0x66b4835d9eafea22ULL, 0x219b97e26ffc81bdULL, 0x261e4e4c0a333a9dULL,
+        0x1fe2cca76517db90ULL, 0xd7504dfa8816edbbULL, 0xb9571fa04dc089c8ULL, 0x1ddc0325259b27deULL,
+        0xcf3f4688801eb9aaULL, 0xf4f5d05c10cab243ULL, 0x38b6525c21a42b0eULL, 0x36f60e2ba4fa6800ULL,
+        0xeb3593803173e0ceULL, 0x9c4cd6257c5a3603ULL, 0xaf0c317d32adaa8aULL, 0x258e5a80c7204c4bULL,
+        0x8b889d624d44885dULL, 0xf4d14597e660f855ULL, 0xd4347f66ec8941c3ULL, 0xe699ed85b0dfb40dULL,
+        0x2472f6207c2d0484ULL, 0xc2a1e7b5b459aeb5ULL, 0xab4f6451cc1d45ecULL, 0x63767572ae3d6174ULL,
+        0xa59e0bd101731a28ULL, 0x116d0016cb948f09ULL, 0x2cf9c8ca052f6e9fULL, 0x0b090a7560a968e3ULL,
+        0xabeeddb2dde06ff1ULL, 0x58efc10b06a2068dULL, 0xc6e57a78fbd986e0ULL, 0x2eab8ca63ce802d7ULL,
+        0x14a195640116f336ULL, 0x7c0828dd624ec390ULL, 0xd74bbe77e6116ac7ULL, 0x804456af10f5fb53ULL,
+        0xebe9ea2adf4321c7ULL, 0x03219a39ee587a30ULL, 0x49787fef17af9924ULL, 0xa1e9300cd8520548ULL,
+        0x5b45e522e4b1b4efULL, 0xb49c3b3995091a36ULL, 0xd4490ad526f14431ULL, 0x12a8f216af9418c2ULL,
+        0x001f837cc7350524ULL, 0x1877b51e57a764d5ULL, 0xa2853b80f17f58eeULL, 0x993e1de72d36d310ULL,
+        0xb3598080ce64a656ULL, 0x252f59cf0d9f04bbULL, 0xd23c8e176d113600ULL, 0x1bda0492e7e4586eULL,
+        0x21e0bd5026c619bfULL, 0x3b097adaf088f94eULL, 0x8d14dedb30be846eULL, 0xf95cffa23af5f6f4ULL,
+        0x3871700761b3f743ULL, 0xca672b91e9e4fa16ULL, 0x64c8e531bff53b55ULL, 0x241260ed4ad1e87dULL,
+        0x106c09b972d2e822ULL, 0x7fba195410e5ca30ULL, 0x7884d9bc6cb569d8ULL, 0x0647dfedcd894a29ULL,
+        0x63573ff03e224774ULL, 0x4fc8e9560f91b123ULL, 0x1db956e450275779ULL, 0xb8d91274b9e9d4fbULL,
+        0xa2ebee47e2fbfce1ULL, 0xd9f1f30ccd97fb09ULL, 0xefed53d75fd64e6bULL, 0x2e6d02c36017f67fULL,
+        0xa9aa4d20db084e9bULL, 0xb64be8d8b25396c1ULL, 0x70cb6af7c2d5bcf0ULL, 0x98f076a4f7a2322eULL,
+        0xbf84470805e69b5fULL, 0x94c3251f06f90cf3ULL, 0x3e003e616a6591e9ULL, 0xb925a6cd0421aff3ULL,
+        0x61bdd1307c66e300ULL, 0xbf8d5108e27e0d48ULL, 0x240ab57a8b888b20ULL, 0xfc87614baf287e07ULL,
+        0xef02cdd06ffdb432ULL, 0xa1082c0466df6c0aULL, 0x8215e577001332c8ULL, 0xd39bb9c3a48db6cfULL,
+        0x2738259634305c14ULL, 0x61cf4f94c97df93dULL, 0x1b6baca2ae4e125bULL, 0x758f450c88572e0bULL,
+        0x959f587d507a8359ULL, 0xb063e962e045f54dULL, 0x60e8ed72c0dff5d1ULL, 0x7b64978555326f9fULL,
+        0xfd080d236da814baULL, 0x8c90fd9b083f4558ULL, 0x106f72fe81e2c590ULL, 0x7976033a39f7d952ULL,
+        0xa4ec0132764ca04bULL, 0x733ea705fae4fa77ULL, 0xb4d8f77bc3e56167ULL, 0x9e21f4f903b33fd9ULL,
+        0x9d765e419fb69f6dULL, 0xd30c088ba61ea5efULL, 0x5d94337fbfaf7f5bULL, 0x1a4e4822eb4d7a59ULL,
+        0x6ffe73e81b637fb3ULL, 0xddf957bc36d8b9caULL, 0x64d0e29eea8838b3ULL, 0x08dd9bdfd96b9f63ULL,
+        0x087e79e5a57d1d13ULL, 0xe328e230e3e2b3fbULL, 0x1c2559e30f0946beULL, 0x720bf5f26f4d2eaaULL,
+        0xb0774d261cc609dbULL, 0x443f64ec5a371195ULL, 0x4112cf68649a260eULL, 0xd813f2fab7f5c5caULL,
+        0x660d3257380841eeULL, 0x59ac2c7873f910a3ULL, 0xe846963877671a17ULL, 0x93b633abfa3469f8ULL,
+        0xc0c0f5a60ef4cdcfULL, 0xcaf21ecd4377b28cULL, 0x57277707199b8175ULL, 0x506c11b9d90e8b1dULL,
+        0xd83cc2687a19255fULL, 0x4a29c6465a314cd1ULL, 0xed2df21216235097ULL, 0xb5635c95ff7296e2ULL,
+        0x22af003ab672e811ULL, 0x52e762596bf68235ULL, 0x9aeba33ac6ecc6b0ULL, 0x944f6de09134dfb6ULL,
+        0x6c47bec883a7de39ULL, 0x6ad047c430a12104ULL, 0xa5b1cfdba0ab4067ULL, 0x7c45d833aff07862ULL,
+        0x5092ef950a16da0bULL, 0x9338e69c052b8e7bULL, 0x455a4b4cfe30e3f5ULL, 0x6b02e63195ad0cf8ULL,
+        0x6b17b224bad6bf27ULL, 0xd1e0ccd25bb9c169ULL, 0xde0c89a556b9ae70ULL, 0x50065e535a213cf6ULL,
+        0x9c1169fa2777b874ULL, 0x78edefd694af1eedULL, 0x6dc93d9526a50e68ULL, 0xee97f453f06791edULL,
+        0x32ab0edb696703d3ULL, 0x3a6853c7e70757a7ULL, 0x31865ced6120f37dULL, 0x67fef95d92607890ULL,
+        0x1f2b1d1f15f6dc9cULL, 0xb69e38a8965c6b65ULL, 0xaa9119ff184cccf4ULL, 0xf43c732873f24c13ULL,
+        0xfb4a3d794a9a80d2ULL, 0x3550c2321fd6109cULL, 0x371f77e76bb8417eULL, 0x6bfa9aae5ec05779ULL,
+        0xcd04f3ff001a4778ULL, 0xe3273522064480caULL, 0x9f91508bffcfc14aULL, 0x049a7f41061a9e60ULL,
+        0xfcb6be43a9f2fe9bULL, 0x08de8a1c7797da9bULL, 0x8f9887e6078735a1ULL, 0xb5b4071dbfc73a66ULL,
+        0x230e343dfba08d33ULL, 0x43ed7f5a0fae657dULL, 0x3a88a0fbbcb05c63ULL, 0x21874b8b4d2dbc4fULL,
+        0x1bdea12e35f6a8c9ULL, 0x53c065c6c8e63528ULL, 0xe34a1d250e7a8d6bULL, 0xd6b04d3b7651dd7eULL,
+        0x5e90277e7cb39e2dULL, 0x2c046f22062dc67dULL, 0xb10bb459132d0a26ULL, 0x3fa9ddfb67e2f199ULL,
+        0x0e09b88e1914f7afULL, 0x10e8b35af3eeab37ULL, 0x9eedeca8e272b933ULL, 0xd4c718bc4ae8ae5fULL,
+        0x81536d601170fc20ULL, 0x91b534f885818a06ULL, 0xec8177f83f900978ULL, 0x190e714fada5156eULL,
+        0xb592bf39b0364963ULL, 0x89c350c893ae7dc1ULL, 0xac042e70f8b383f2ULL, 0xb49b52e587a1ee60ULL,
+        0xfb152fe3ff26da89ULL, 0x3e666e6f69ae2c15ULL, 0x3b544ebe544c19f9ULL, 0xe805a1e290cf2456ULL,
+        0x24b33c9d7ed25117ULL, 0xe74733427b72f0c1ULL, 0x0a804d18b7097475ULL, 0x57e3306d881edb4fULL,
+        0x4ae7d6a36eb5dbcbULL, 0x2d8d5432157064c8ULL, 0xd1e649de1e7f268bULL, 0x8a328a1cedfe552cULL,
+        0x07a3aec79624c7daULL, 0x84547ddc3e203c94ULL, 0x990a98fd5071d263ULL, 0x1a4ff12616eefc89ULL,
+        0xf6f7fd1431714200ULL, 0x30c05b1ba332f41cULL, 0x8d2636b81555a786ULL, 0x46c9feb55d120902ULL,
+        0xccec0a73b49c9921ULL, 0x4e9d2827355fc492ULL, 0x19ebb029435dcb0fULL, 0x4659d2b743848a2cULL,
+        0x963ef2c96b33be31ULL, 0x74f85198b05a2e7dULL, 0x5a0f544dd2b1fb18ULL, 0x03727073c2e134b1ULL,
+        0xc7f6aa2de59aea61ULL, 0x352787baa0d7c22fULL, 0x9853eab63b5e0b35ULL, 0xabbdcdd7ed5c0860ULL,
+        0xcf05daf5ac8d77b0ULL, 0x49cad48cebf4a71eULL, 0x7a4c10ec2158c4a6ULL, 0xd9e92aa246bf719eULL,
+        0x13ae978d09fe5557ULL, 0x730499af921549ffULL, 0x4e4b705b92903ba4ULL, 0xff577222c14f0a3aULL,
+        0x55b6344cf97aafaeULL, 0xb862225b055b6960ULL, 0xcac09afbddd2cdb4ULL, 0xdaf8e9829fe96b5fULL,
+        0xb5fdfc5d3132c498ULL, 0x310cb380db6f7503ULL, 0xe87fbb46217a360eULL, 0x2102ae466ebb1148ULL,
+        0xf8549e1a3aa5e00dULL, 0x07a69afdcc42261aULL, 0xc4c118bfe78feaaeULL, 0xf9f4892ed96bd438ULL,
+        0x1af3dbe25d8f45daULL, 0xf5b4b0b0d2deeeb4ULL, 0x962aceefa82e1c84ULL, 0x046e3ecaaf453ce9ULL,
+        0xf05d129681949a4cULL, 0x964781ce734b3c84ULL, 0x9c2ed44081ce5fbdULL, 0x522e23f3925e319eULL,
+        0x177e00f9fc32f791ULL, 0x2bc60a63a6f3b3f2ULL, 0x222bbfae61725606ULL, 0x486289ddcc3d6780ULL,
+        0x7dc7785b8efdfc80ULL, 0x8af38731c02ba980ULL, 0x1fab64ea29a2ddf7ULL, 0xe4d9429322cd065aULL,
+        0x9da058c67844f20cULL, 0x24c0e332b70019b0ULL, 0x233003b5a6cfe6adULL, 0xd586bd01c5c217f6ULL,
+        0x5e5637885f29bc2bULL, 0x7eba726d8c94094bULL, 0x0a56a5f0bfe39272ULL, 0xd79476a84ee20d06ULL,
+        0x9e4c1269baa4bf37ULL, 0x17efee45b0dee640ULL, 0x1d95b0a5fcf90bc6ULL, 0x93cbe0b699c2585dULL,
+        0x65fa4f227a2b6d79ULL, 0xd5f9e858292504d5ULL, 0xc2b5a03f71471a6fULL, 0x59300222b4561e00ULL,
+        0xce2f8642ca0712dcULL, 0x7ca9723fbb2e8988ULL, 0x2785338347f2ba08ULL, 0xc61bb3a141e50e8cULL,
+        0x150f361dab9dec26ULL, 0x9f6a419d382595f4ULL, 0x64a53dc924fe7ac9ULL, 0x142de49fff7a7c3dULL,
+        0x0c335248857fa9e7ULL, 0x0a9c32d5eae45305ULL, 0xe6c42178c4bbb92eULL, 0x71f1ce2490d20b07ULL,
+        0xf1bcc3d275afe51aULL, 0xe728e8c83c334074ULL, 0x96fbf83a12884624ULL, 0x81a1549fd6573da5ULL,
+        0x5fa7867caf35e149ULL, 0x56986e2ef3ed091bULL, 0x917f1dd5f8886c61ULL, 0xd20d8c88c8ffe65fULL,
+        0x31d71dce64b2c310ULL, 0xf165b587df898190ULL, 0xa57e6339dd2cf3a0ULL, 0x1ef6e6dbb1961ec9ULL,
+        0x70cc73d90bc26e24ULL, 0xe21a6b35df0c3ad7ULL, 0x003a93d8b2806962ULL, 0x1c99ded33cb890a1ULL,
+        0xcf3145de0add4289ULL, 0xd0e4427a5514fb72ULL, 0x77c621cc9fb3a483ULL, 0x67a34dac4356550bULL,
+        0xf8d626aaaf278509ULL,
+};
+
+// polyglot reference keys, a table that doesn't reproduce them isn't the standard one
+struct PolyglotKeyTest {
+    const char *moves;
+    U64 key;
+};
+
+const PolyglotKeyTest polyglotKeyTests[] = {
+        {"", 0x463b96181691fc9cULL},
+        {"e4", 0x823c9b50fd114196ULL},
+        {"e4 d5", 0x0756b94461c50fb0ULL},
+        {"e4 d5 e5", 0x662fafb965db29d4ULL},
+        {"e4 d5 e5 f5", 0x22a48b5a8e47ff78ULL},
+        {"e4 d5 e5 f5 Ke2", 0x652a607ca3f242c1ULL},
+        {"e4 d5 e5 f5 Ke2 Kf7", 0x00fdd303c946bdd9ULL},
+        {"a4 b5 h4 b4 c4", 0x3c8123ea7b067637ULL},
+        {"a4 b5 h4 b4 c4 bxc3 Ra3", 0x5c3f9b829b279560ULL},
+};
+
+// read big endian number of bytes
+static inline U64 readBigEndian(const uint8_t *data, int bytes) {
+    U64 value = 0ULL;
+    for (int i = 0; i < bytes; i++) value = (value << 8) | data[i];
+    return value;
+}
+
+// write big endian number of bytes
+static inline void writeBigEndian(uint8_t *data, U64 value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--, value >>= 8) data[i] = (uint8_t) value;
+}
+
+// polyglot hash key of position
+U64 polyglotKey(const CBoard &board) {
+    U64 key = 0ULL;
+
+    for (int square = 0; square < 64; square++) {
+        int piece = board.mailbox[square];
+        if (piece == NO_PIECE) continue;
+
+        // kinds alternate black and white (black pawn 0, white pawn 1, ...), rows count from rank 1
+        int kind = 2 * get_piece_type(piece) + (get_piece_color(piece) == white);
+        key ^= polyglotRandom[64 * kind + 8 * (7 - square / 8) + square % 8];
+    }
+
+    if (board.castling & wk) key ^= polyglotRandom[POLYGLOT_CASTLING_OFFSET];
+    if (board.castling & wq) key ^= polyglotRandom[POLYGLOT_CASTLING_OFFSET + 1];
+    if (board.castling & bk) key ^= polyglotRandom[POLYGLOT_CASTLING_OFFSET + 2];
+    if (board.castling & bq) key ^= polyglotRandom[POLYGLOT_CASTLING_OFFSET + 3];
+
+    // board only keeps en passant squares a pawn of side to move can capture on, as polyglot hashes them
+    if (board.enPassant != no_sq) key ^= polyglotRandom[POLYGLOT_EN_PASSANT_OFFSET + board.enPassant % 8];
+
+    if (board.side == white) key ^= polyglotRandom[POLYGLOT_TURN_OFFSET];
+
+    return key;
+}
+
+// parse move in standard algebraic notation (Nbd7, exd6, e8=Q+, O-O) into legal move of board, NO_MOVE if none
+Move parseSanMove(const CBoard &board, const char *san) {
+    char text[16];
+    int length = 0;
+
+    // drop check, mate and annotation symbols
+    for (const char *c = san; *c && length < 15; c++) {
+        if (!strchr("+#!?", *c)) text[length++] = *c;
+    }
+    text[length] = '\0';
+
+    MoveList list;
+    generateMoves(board, list);
+
+    // castling (letter O or digit zero)
+    if (!strcmp(text, "O-O") || !strcmp(text, "0-0") || !strcmp(text, "O-O-O") || !strcmp(text, "0-0-0")) {
+        int flags = length == 3 ? kingCastle : queenCastle;
+        for (int i = 0; i < list.count; i++) {
+            if (get_move_flags(list.moves[i]) == flags) return list.moves[i];
+        }
+        return NO_MOVE;
+    }
+
+    // piece letter, pawn moves have none
+    int pieceType = pawn;
+    const char *letter = length ? strchr("NBRQK", text[0]) : nullptr;
+    int start = 0;
+    if (letter) {
+        pieceType = knight + (int) (letter - "NBRQK");
+        start = 1;
+    }
+
+    // promotion piece (e8=Q or e8Q)
+    int promoted = 0;
+    if (length >= 2 && strchr("NBRQ", text[length - 1])) {
+        promoted = knight + (int) (strchr("NBRQ", text[length - 1]) - "NBRQ");
+        length -= text[length - 2] == '=' ? 2 : 1;
+    }
+
+    // target square is last, disambiguation file and rank come before it
+    if (length - start < 2) return NO_MOVE;
+    int targetFile = text[length - 2] - 'a';
+    int targetRank = text[length - 1] - '1';
+    if (targetFile < 0 || targetFile > 7 || targetRank < 0 || targetRank > 7) return NO_MOVE;
+    int target = (7 - targetRank) * 8 + targetFile;
+
+    int sourceFile = -1, sourceRank = -1;
+    for (int i = start; i < length - 2; i++) {
+        if (text[i] >= 'a' && text[i] <= 'h') sourceFile = text[i] - 'a';
+        else if (text[i] >= '1' && text[i] <= '8') sourceRank = text[i] - '1';
+        else if (text[i] != 'x' && text[i] != '-') return NO_MOVE;
+    }
+
+    Move found = NO_MOVE;
+    for (int i = 0; i < list.count; i++) {
+        Move move = list.moves[i];
+        int source = get_move_source(move);
+
+        if (get_move_target(move) != target || get_piece_type(board.mailbox[source]) != pieceType) continue;
+        if ((is_promotion(move) ? get_move_promoted(move) : 0) != promoted) continue;
+        if (sourceFile >= 0 && source % 8 != sourceFile) continue;
+        if (sourceRank >= 0 && 7 - source / 8 != sourceRank) continue;
+
+        // ambiguous
+        if (found != NO_MOVE) return NO_MOVE;
+        found = move;
+    }
+
+    return found;
+}
+
+// does the random table reproduce the polyglot reference keys
+bool checkPolyglotRandom() {
+    CBoard *board = new CBoard();
+    bool passed = true;
+
+    for (const PolyglotKeyTest &test : polyglotKeyTests) {
+        board->parseFen(START_POSITION);
+
+        const char *moves = test.moves;
+        char moveString[8];
+        int length;
+
+        while (sscanf(moves, "%7s%n", moveString, &length) == 1) {
+            Move move = parseSanMove(*board, moveString);
+            if (move == NO_MOVE) break;
+
+            board->makeMove(move);
+            moves += length;
+        }
+
+        passed &= polyglotKey(*board) == test.key;
+    }
+
+    delete board;
+    return passed;
+}
+
+// polyglot book entry: key (8 bytes), move (2), weight (2), learn (4), big endian
+#define POLYGLOT_ENTRY_SIZE 16
+
+// maximum number of book moves of one position
+#define MAX_BOOK_MOVES 64
+
+// memory mapped polyglot book (entries sorted by key)
+struct PolyglotBook {
+    const uint8_t *entries = nullptr;
+    size_t count = 0;
+
+    // mapped file
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+
+    // key of entry
+    U64 key(size_t index) const {
+        return readBigEndian(entries + index * POLYGLOT_ENTRY_SIZE, 8);
+    }
+
+    // move and weight of entry
+    int move(size_t index) const {
+        return (int) readBigEndian(entries + index * POLYGLOT_ENTRY_SIZE + 8, 2);
+    }
+
+    int weight(size_t index) const {
+        return (int) readBigEndian(entries + index * POLYGLOT_ENTRY_SIZE + 10, 2);
+    }
+
+    // index of first entry with key not below key (binary search)
+    size_t lowerBound(U64 searchKey) const {
+        size_t low = 0, high = count;
+
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (key(middle) < searchKey) low = middle + 1;
+            else high = middle;
+        }
+
+        return low;
+    }
+};
+
+// opening book (used by uci when OwnBook is set)
+PolyglotBook book;
+bool ownBook = false;
+
+// book move choice random state (seeded from the clock when a book is loaded)
+unsigned int bookRandomState = 1;
+
+// release opening book
+void unloadBook() {
+    if (book.mapping) unmapFile(book.mapping, book.mappingSize);
+    book = PolyglotBook();
+}
+
+// map polyglot book read only (processes using the same book share its pages), old book stays on failure
+bool loadBook(const char *path) {
+    size_t size = 0;
+    void *mapping = mapFile(path, size);
+    if (!mapping) return false;
+
+    if (size % POLYGLOT_ENTRY_SIZE) {
+        unmapFile(mapping, size);
+        return false;
+    }
+
+    unloadBook();
+    book.entries = (const uint8_t *) mapping;
+    book.count = size / POLYGLOT_ENTRY_SIZE;
+    book.mapping = mapping;
+    book.mappingSize = size;
+
+    bookRandomState = (unsigned int) getTimeNs() | 1;
+    return true;
+}
+
+// polyglot encoding of move: to file, to row, from file, from row (3 bits each), promotion (n = 1 ... q = 4),
+// castling is encoded as king takes own rook
+int polyglotMove(Move move) {
+    int source = get_move_source(move);
+    int target = get_move_target(move);
+    int flags = get_move_flags(move);
+
+    if (flags == kingCastle) target++;
+    else if (flags == queenCastle) target -= 2;
+
+    int encoded = (target % 8) | ((7 - target / 8) << 3) | ((source % 8) << 6) | ((7 - source / 8) << 9);
+    if (is_promotion(move)) encoded |= (get_move_promoted(move) - knight + 1) << 12;
+
+    return encoded;
+}
+
+// legal moves of board in book with their weights, returns their count
+int probeBook(const CBoard &board, Move *moves, int *weights) {
+    if (!book.entries) return 0;
+
+    U64 key = polyglotKey(board);
+    MoveList list;
+    generateMoves(board, list);
+
+    int count = 0;
+    for (size_t index = book.lowerBound(key); index < book.count && book.key(index) == key; index++) {
+        int encoded = book.move(index);
+
+        // entries of other positions with the same key or broken entries match no legal move
+        for (int i = 0; i < list.count && count < MAX_BOOK_MOVES; i++) {
+            if (polyglotMove(list.moves[i]) == encoded) {
+                moves[count] = list.moves[i];
+                weights[count++] = book.weight(index);
+                break;
+            }
+        }
+    }
+
+    return count;
+}
+
+// book move of board picked with probability proportional to its weight, NO_MOVE if out of book
+Move bookMove(const CBoard &board) {
+    Move moves[MAX_BOOK_MOVES];
+    int weights[MAX_BOOK_MOVES];
+    int count = probeBook(board, moves, weights);
+
+    int total = 0;
+    for (int i = 0; i < count; i++) total += weights[i];
+    if (!total) return NO_MOVE;
+
+    int pick = (int) (getRandomU32Number(bookRandomState) % (unsigned int) total);
+    for (int i = 0; i < count; i++) {
+        pick -= weights[i];
+        if (pick < 0) return moves[i];
+    }
+
+    return NO_MOVE;
+}
+
+// default number of plies of a game going into a built book
+#define BOOK_BUILD_PLIES 30
+
+// book entries collected in memory before they are sorted and written out as a run
+#define BOOK_BUILD_BUFFER (1 << 22)
+
+// book entry while building: weights are summed over all games before they are scaled into 16 bits
+struct BookBuildEntry {
+    U64 key;
+    uint32_t move;
+    uint32_t weight;
+
+    bool operator<(const BookBuildEntry &other) const {
+        return key != other.key ? key < other.key : move < other.move;
+    }
+};
+
+// streams pgn games into sorted runs of book entries on temporary files, then merges the runs into the book
+// (memory use is bounded by the run buffer, not by the number of games)
+struct BookBuilder {
+    int maxPlies;
+    std::vector<BookBuildEntry> buffer;
+    std::vector<FILE *> runs;
+    U64 games = 0ULL;
+    U64 skippedGames = 0ULL;
+
+    // game being parsed: start position, (key, move, side to move) of its first plies
+    CBoard *board = new CBoard();
+    std::string fen;
+    bool inGame = false;
+    bool illegal = false;
+    std::vector<BookBuildEntry> gameEntries;
+    std::vector<int> gameSides;
+
+    explicit BookBuilder(int maxPlies) : maxPlies(std::min(std::max(maxPlies, 1), MAX_GAME_PLY - 1)) {
+        buffer.reserve(BOOK_BUILD_BUFFER);
+    }
+
+    ~BookBuilder() {
+        for (FILE *run : runs) fclose(run);
+        delete board;
+    }
+
+    // sort buffer, combine equal entries and write it out as a run
+    bool flushRun() {
+        if (buffer.empty()) return true;
+
+        std::sort(buffer.begin(), buffer.end());
+
+        FILE *run = tmpfile();
+        if (!run) return false;
+        runs.push_back(run);
+
+        for (size_t i = 0; i < buffer.size();) {
+            BookBuildEntry entry = buffer[i++];
+            for (; i < buffer.size() && buffer[i].key == entry.key && buffer[i].move == entry.move; i++) {
+                entry.weight += buffer[i].weight;
+            }
+            fwrite(&entry, sizeof(entry), 1, run);
+        }
+
+        buffer.clear();
+        rewind(run);
+        return !ferror(run);
+    }
+
+    // header tag (only FEN matters, results are taken from the game termination), false on write error
+    bool tag(const std::string &name, const std::string &value) {
+        // a tag ends a game without termination
+        bool written = endGame(nullptr);
+        if (name == "FEN") fen = value;
+        return written;
+    }
+
+    // move text token: move number, san move or game termination, false on write error
+    bool token(const char *text) {
+        if (!strcmp(text, "1-0") || !strcmp(text, "0-1") || !strcmp(text, "1/2-1/2") || !strcmp(text, "*")) {
+            // a termination without moves still ends the game of the tags before it
+            if (!inGame) fen.clear();
+            return endGame(text);
+        }
+
+        // move numbers (12. or 12...) may stick to the move
+        while (*text >= '0' && *text <= '9') text++;
+        while (*text == '.') text++;
+        if (!*text) return true;
+
+        if (!inGame) {
+            inGame = true;
+            illegal = !board->parseFen(fen.empty() ? START_POSITION : fen.c_str());
+            gameEntries.clear();
+            gameSides.clear();
+        }
+
+        if (illegal || (int) gameEntries.size() >= maxPlies) return true;
+
+        Move move = parseSanMove(*board, text);
+        if (move == NO_MOVE) {
+            illegal = true;
+            return true;
+        }
+
+        gameEntries.push_back({polyglotKey(*board), (uint32_t) polyglotMove(move), 0});
+        gameSides.push_back(board->side);
+        board->makeMove(move);
+        return true;
+    }
+
+    // weigh the moves of finished game by result from the mover's point of view (win 2, draw 1, loss 0),
+    // false on write error
+    bool endGame(const char *result) {
+        if (!inGame) return true;
+        inGame = false;
+        fen.clear();
+
+        int winner = result && !strcmp(result, "1-0") ? white : result && !strcmp(result, "0-1") ? black : -1;
+        bool draw = result && !strcmp(result, "1/2-1/2");
+
+        // games with unknown result or an unreadable move are skipped
+        if ((winner < 0 && !draw) || illegal) {
+            skippedGames++;
+            return true;
+        }
+
+        games++;
+        for (size_t i = 0; i < gameEntries.size(); i++) {
+            BookBuildEntry entry = gameEntries[i];
+            entry.weight = draw ? 1 : gameSides[i] == winner ? 2 : 0;
+            if (entry.weight) buffer.push_back(entry);
+        }
+
+        return buffer.size() + maxPlies <= BOOK_BUILD_BUFFER || flushRun();
+    }
+
+    // stream pgn file through the builder
+    bool readPgn(FILE *pgn) {
+        std::string word;
+        int c;
+
+        while ((c = getc(pgn)) != EOF) {
+            if (c == '[') {
+                // tag pair [Name "value"]
+                std::string name, value;
+                while ((c = getc(pgn)) != EOF && c != ']' && c != '"') {
+                    if (!isspace(c)) name += (char) c;
+                }
+                if (c == '"') {
+                    while ((c = getc(pgn)) != EOF && c != '"') {
+                        if (c == '\\') c = getc(pgn);
+                        if (c != EOF) value += (char) c;
+                    }
+                    while (c != EOF && c != ']') c = getc(pgn);
+                }
+                if (!tag(name, value)) return false;
+            }
+            else if (c == '{') {
+                while ((c = getc(pgn)) != EOF && c != '}') {}
+            }
+            else if (c == ';' || c == '%') {
+                while ((c = getc(pgn)) != EOF && c != '\n') {}
+            }
+            else if (c == '(') {
+                // variations (nested, with comments) are skipped
+                int depth = 1;
+                while (depth && (c = getc(pgn)) != EOF) {
+                    if (c == '(') depth++;
+                    else if (c == ')') depth--;
+                    else if (c == '{') while ((c = getc(pgn)) != EOF && c != '}') {}
+                }
+            }
+            else if (!isspace(c)) {
+                word = (char) c;
+                while ((c = getc(pgn)) != EOF && !isspace(c) && !strchr("{}()[];", c)) word += (char) c;
+                if (c != EOF) ungetc(c, pgn);
+
+                // numeric annotation glyphs ($1) carry no move
+                if (word[0] != '$' && !token(word.c_str())) return false;
+            }
+        }
+
+        return endGame(nullptr) && flushRun();
+    }
+
+    // merge runs into polyglot book, moves of a position by descending weight
+    bool writeBook(FILE *out, U64 &entries, U64 &positions) {
+        struct RunHead {
+            BookBuildEntry entry;
+            size_t run;
+            bool operator<(const RunHead &other) const { return other.entry < entry; }
+        };
+
+        std::vector<RunHead> heap;
+        for (size_t i = 0; i < runs.size(); i++) {
+            RunHead head{{}, i};
+            if (fread(&head.entry, sizeof(BookBuildEntry), 1, runs[i]) == 1) heap.push_back(head);
+        }
+        std::make_heap(heap.begin(), heap.end());
+
+        std::vector<BookBuildEntry> position;
+        entries = positions = 0ULL;
+
+        // next entry of all runs in key order (equal entries of different runs are combined)
+        auto next = [&](BookBuildEntry &entry) {
+            if (heap.empty()) return false;
+
+            std::pop_heap(heap.begin(), heap.end());
+            RunHead &head = heap.back();
+            entry = head.entry;
+            if (fread(&head.entry, sizeof(BookBuildEntry), 1, runs[head.run]) == 1) {
+                std::push_heap(heap.begin(), heap.end());
+            }
+            else {
+                heap.pop_back();
+            }
+            return true;
+        };
+
+        // write moves of one position
+        auto writePosition = [&]() {
+            std::stable_sort(position.begin(), position.end(), [](const BookBuildEntry &a, const BookBuildEntry &b) {
+                return a.weight > b.weight;
+            });
+
+            // weights of a position are scaled down together when the largest one doesn't fit into 16 bits
+            U64 largest = position.empty() ? 0 : position.front().weight;
+
+            for (const BookBuildEntry &entry : position) {
+                U64 weight = largest > 0xffff ? std::max<U64>(entry.weight * 0xffffULL / largest, 1) : entry.weight;
+
+                uint8_t data[POLYGLOT_ENTRY_SIZE] = {};
+                writeBigEndian(data, entry.key, 8);
+                writeBigEndian(data + 8, entry.move, 2);
+                writeBigEndian(data + 10, weight, 2);
+                fwrite(data, sizeof(data), 1, out);
+                entries++;
+            }
+
+            positions += !position.empty();
+            position.clear();
+        };
+
+        BookBuildEntry entry;
+        while (next(entry)) {
+            if (!position.empty() && position.back().key != entry.key) writePosition();
+
+            if (!position.empty() && position.back().move == entry.move) position.back().weight += entry.weight;
+            else position.push_back(entry);
+        }
+        writePosition();
+
+        return !ferror(out);
+    }
+};
+
+// build polyglot book from the first plies of every game of pgn file
+bool buildBook(const char *pgnPath, const char *bookPath, int maxPlies) {
+    FILE *pgn = fopen(pgnPath, "r");
+    if (!pgn) {
+        printf("cannot open %s\n", pgnPath);
+        return false;
+    }
+
+    long long start = getTimeNs();
+    BookBuilder *builder = new BookBuilder(maxPlies);
+    bool read = builder->readPgn(pgn);
+    fclose(pgn);
+
+    FILE *out = read ? fopen(bookPath, "wb") : nullptr;
+    U64 entries = 0ULL, positions = 0ULL;
+    bool written = out && builder->writeBook(out, entries, positions);
+    if (out && fclose(out)) written = false;
+
+    if (written) {
+        printf("\n  games:      %llu (%llu skipped)\n", builder->games, builder->skippedGames);
+        printf("  runs:       %zu\n", builder->runs.size());
+        printf("  positions:  %llu\n", positions);
+        printf("  entries:    %llu\n", entries);
+        printf("  time:       %.3f s\n\n", (getTimeNs() - start) / 1e9);
+    }
+    else {
+        printf("cannot write %s\n", bookPath);
+    }
+
+    delete builder;
+    return written;
+}
+
+// print book moves of position
+void printBookMoves(const CBoard &board) {
+    Move moves[MAX_BOOK_MOVES];
+    int weights[MAX_BOOK_MOVES];
+    int count = probeBook(board, moves, weights);
+    char moveString[6];
+
+    printf("\n  key: %016llx\n", polyglotKey(board));
+    for (int i = 0; i < count; i++) {
+        printf("  %-6s %6d\n", moveToString(moves[i], moveString), weights[i]);
+    }
+    printf("\n");
+}
+
+/*********************\
+ ======================
+          UCI
+ ======================
+\*********************/
+
+// engine name reported to the gui
+#define ENGINE_NAME "chess_engine"
+#define ENGINE_AUTHOR "Christofuu"
+
+// parse move string (e.g. e7e8q) into legal move of board, NO_MOVE if illegal
+Move parseMove(CBoard &board, const char *moveString) {
+    char legalMoveString[6];
+    MoveList list;
+    generateMoves(board, list);
+
+    for (int i = 0; i < list.count; i++) {
+        if (!strcmp(moveToString(list.moves[i], legalMoveString), moveString)) {
+            return list.moves[i];
+        }
+    }
+
+    return NO_MOVE;
+}
+
+// uci search runs on its own thread so the input loop keeps answering
+std::thread uciSearchThread;
+
+// stop running search and wait for it to print bestmove
+void stopSearch() {
+    if (uciSearchThread.joinable()) {
+        mainSearch.stopped = true;
+        mainSearch.pondering = false;
+        uciSearchThread.join();
+    }
+}
+
+// parse "position [startpos | fen <fen>] [moves <moves>]", returns false on an invalid fen (the board is reset to the
+// start position only to keep it consistent, it must not be searched)
+bool parsePosition(CBoard &board, const std::string &command) {
+    size_t movesIndex = command.find(" moves");
+
+    if (command.compare(9, 8, "startpos") == 0) {
+        board.parseFen(START_POSITION);
+    }
+    else if (command.compare(9, 4, "fen ") == 0) {
+        std::string fen = command.substr(13, movesIndex == std::string::npos ? std::string::npos : movesIndex - 13);
+        if (!board.parseFen(fen.c_str())) {
+            printf("info string invalid fen %s\n", fen.c_str());
+            board.parseFen(START_POSITION);
+            return false;
+        }
+    }
+
+    if (movesIndex == std::string::npos) return true;
+
+    // play moves (reversible moves stay on the undo stack for repetition detection)
+    const char *moves = command.c_str() + movesIndex + 6;
+    char moveString[8];
+    int length;
+
+    while (sscanf(moves, "%7s%n", moveString, &length) == 1) {
+        Move move = parseMove(board, moveString);
+        if (move == NO_MOVE) {
+            printf("info string illegal move %s\n", moveString);
+            break;
+        }
+
+        board.makeMove(move);
+        moves += length;
+
+        // undo stack is only needed back to the last irreversible move
+        if (board.halfmoveClock == 0) board.undoCount = 0;
+    }
+
+    return true;
+}
+
+// parse "go [depth n] [nodes n] [movetime ms] [wtime ms] [btime ms] [winc ms] [binc ms] [movestogo n]
+// [infinite] [ponder]" and start search thread
+void parseGo(const CBoard &board, const std::string &command) {
+    SearchLimits limits;
+    char token[32];
+    long long value;
+    int length;
+    const char *arguments = command.c_str() + 2;
+
+    while (sscanf(arguments, "%31s%n", token, &length) == 1) {
+        arguments += length;
+
+        if (!strcmp(token, "infinite")) limits.infinite = true;
+        else if (!strcmp(token, "ponder")) limits.ponder = true;
+        else if (sscanf(arguments, "%lld%n", &value, &length) == 1) {
+            arguments += length;
+
+            if (!strcmp(token, "depth")) limits.depth = (int) value;
+            else if (!strcmp(token, "nodes")) limits.nodes = (U64) value;
+            else if (!strcmp(token, "movetime")) limits.movetime = value;
+            else if (!strcmp(token, "wtime")) limits.time[white] = value;
+            else if (!strcmp(token, "btime")) limits.time[black] = value;
+            else if (!strcmp(token, "winc")) limits.inc[white] = value;
+            else if (!strcmp(token, "binc")) limits.inc[black] = value;
+            else if (!strcmp(token, "movestogo")) limits.movestogo = (int) value;
+        }
+    }
+
+    stopSearch();
+
+    // book moves are played right away (not while pondering or analysing)
+    if (ownBook && !limits.ponder && !limits.infinite) {
+        Move move = bookMove(board);
+        if (move != NO_MOVE) {
+            char moveString[6];
+            printf("info string book move\n");
+            printf("bestmove %s\n", moveToString(move, moveString));
+            fflush(stdout);
+            return;
+        }
+    }
+
+    // set flags before returning, a stop or ponderhit may follow right away
+    mainSearch.stopped = false;
+    mainSearch.pondering = limits.ponder;
+
+    uciSearchThread = std::thread([board, limits]() {
+        searchPosition(mainSearch, board, limits, searchThreadCount);
+    });
+}
+
+// parse "setoption name <name> value <value>"
+void parseSetOption(const std::string &command) {
+    size_t nameIndex = command.find("name ");
+    size_t valueIndex = command.find(" value ");
+    if (nameIndex == std::string::npos || valueIndex == std::string::npos) return;
+
+    std::string name = command.substr(nameIndex + 5, valueIndex - nameIndex - 5);
+    int value = atoi(command.c_str() + valueIndex + 7);
+
+    if (name == "Hash") {
+        stopSearch();
+        transpositionTable.resize(std::max(value, 1));
+    }
+    else if (name == "Threads") {
+        stopSearch();
+        searchThreadCount = std::max(value, 1);
+    }
+    else if (name == "EvalFile") {
+        stopSearch();
+        std::string path = command.substr(valueIndex + 7);
+
+        // empty path switches back to the handcrafted evaluation
+        if (path.empty() || path == "<empty>") {
+            unloadNetwork();
+            printf("info string handcrafted evaluation\n");
+        }
+        else if (loadNetwork(path.c_str())) {
+            printf("info string network %s loaded (%s kernels)\n", path.c_str(), nnueBackendNames[nnueBackend]);
+        }
+        else {
+            printf("info string cannot load network %s\n", path.c_str());
+        }
+    }
+    else if (name == "OwnBook") {
+        ownBook = command.compare(valueIndex + 7, 4, "true") == 0;
+    }
+    else if (name == "BookFile") {
+        std::string path = command.substr(valueIndex + 7);
+
+        if (path.empty() || path == "<empty>") {
+            unloadBook();
+        }
+        else if (loadBook(path.c_str())) {
+            printf("info string book %s loaded (%zu entries)\n", path.c_str(), book.count);
+        }
+        else {
+            printf("info string cannot load book %s\n", path.c_str());
+        }
+    }
+}
+
+// uci input loop
+void uciLoop() {
+    CBoard *board = new CBoard();
+    board->parseFen(START_POSITION);
+
+    // false after a position command with an invalid fen, until the next valid one
+    bool positionValid = true;
+
+    // unbuffered input, line buffered output so the gui sees every line right away
+    setvbuf(stdin, nullptr, _IONBF, 0);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    std::string command;
+    while (std::getline(std::cin, command)) {
+        if (command == "uci") {
+            printf("id name %s\n", ENGINE_NAME);
+            printf("id author %s\n", ENGINE_AUTHOR);
+            printf("option name Hash type spin default %d min 1 max 65536\n", DEFAULT_HASH_MB);
+            printf("option name Threads type spin default 1 min 1 max 1024\n");
+            printf("option name Ponder type check default false\n");
+            printf("option name EvalFile type string default <empty>\n");
+            printf("option name OwnBook type check default false\n");
+            printf("option name BookFile type string default <empty>\n");
+            printf("uciok\n");
+        }
+        else if (command == "isready") {
+            printf("readyok\n");
+        }
+        else if (command == "ucinewgame") {
+            stopSearch();
+            transpositionTable.clear();
+        }
+        else if (!command.compare(0, 9, "position ")) {
+            stopSearch();
+            positionValid = parsePosition(*board, command);
+        }
+        else if (command == "go" || !command.compare(0, 3, "go ")) {
+            // a null move answers go without playing a move of some other position
+            if (!positionValid) {
+                stopSearch();
+                printf("info string no valid position\n");
+                printf("bestmove 0000\n");
+            }
+            else {
+                parseGo(*board, command);
+            }
+        }
+        else if (command == "stop") {
+            stopSearch();
+        }
+        else if (command == "ponderhit") {
+            // search continues on own time from now on
+            mainSearch.startNs = getTimeNs();
+            mainSearch.pondering = false;
+        }
+        else if (!command.compare(0, 10, "setoption ")) {
+            parseSetOption(command);
+        }
+        else if (command == "d") {
+            board->print();
+        }
+        else if (command == "quit") {
+            break;
+        }
+    }
+
+    stopSearch();
+    delete board;
+}
+
+/*********************\
+ ======================
+     Batch Analysis
+ ======================
+\*********************/
+
+// batch job: input line and its position in the input
+struct BatchJob {
+    U64 index;
+    std::string line;
+};
+
+// bounded job queue feeding the batch workers, results are written in input order
+struct BatchPipeline {
+    std::mutex mutex;
+    std::condition_variable jobAdded, jobTaken;
+    std::deque<BatchJob> jobs;
+    size_t capacity;
+    bool closed = false;
+
+    // finished results waiting for earlier ones, next index to write
+    std::map<U64, std::string> results;
+    U64 nextIndex = 0ULL;
+
+    explicit BatchPipeline(size_t capacity) : capacity(capacity) {}
+
+    // block while the queue is full or too many results wait for a slow earlier job
+    void push(BatchJob &&job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobTaken.wait(lock, [&] { return jobs.size() < capacity && job.index - nextIndex < 4 * capacity; });
+        jobs.push_back(std::move(job));
+        jobAdded.notify_one();
+    }
+
+    // returns false once the queue is closed and drained
+    bool pop(BatchJob &job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobAdded.wait(lock, [&] { return !jobs.empty() || closed; });
+        if (jobs.empty()) return false;
+
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        jobTaken.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        jobAdded.notify_all();
+    }
+
+    // store result and write every result that is next in order
+    void finish(U64 index, std::string &&result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.emplace(index, std::move(result));
+
+        for (auto next = results.find(nextIndex); next != results.end(); next = results.find(nextIndex)) {
+            fputs(next->second.c_str(), stdout);
+            results.erase(next);
+            nextIndex++;
+        }
+        jobTaken.notify_all();
+    }
+};
+
+// escape string for a json string literal
+std::string jsonEscape(const std::string &text) {
+    std::string escaped;
+    char code[8];
+
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ((unsigned char) c < 0x20) {
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// analyse one FEN/EPD line, returns result as json line
+// (perftDepth > 0 counts perft nodes, otherwise the position is searched to the limits)
+std::string analyseBatchLine(SearchState &search, CBoard &board, const BatchJob &job, const SearchLimits &limits,
+                             int perftDepth) {
+    char buffer[256], moveString[6];
+    std::string json = "{\"index\":" + std::to_string(job.index) + ",\"fen\":\"" + jsonEscape(job.line) + "\"";
+
+    // EPD operations after the four position fields are ignored by the FEN parser, positions the board can't play
+    // from (missing kings, back rank pawns, side not to move in check) are reported instead of searched
+    int status = board.readFen(job.line.c_str());
+    if (status == CBoard::fenMalformed) {
+        return json + ",\"error\":\"invalid fen\"}\n";
+    }
+    if (status == CBoard::fenIllegal) {
+        return json + ",\"error\":\"illegal position\"}\n";
+    }
+
+    if (perftDepth > 0) {
+        long long start = getTimeNs();
+        U64 nodes = perftNodes(board, perftDepth);
+        snprintf(buffer, sizeof(buffer), ",\"depth\":%d,\"nodes\":%llu,\"time_ms\":%.3f}\n", perftDepth, nodes,
+                 (getTimeNs() - start) / 1e6);
+        return json + buffer;
+    }
+
+    // every job starts from an empty table, so its result doesn't depend on the jobs before it
+    search.tt->clear();
+    search.stopped = false;
+    search.pondering = false;
+    SearchResult result = searchPosition(search, board, limits, 1, false);
+
+    if (result.bestMove == NO_MOVE) {
+        snprintf(buffer, sizeof(buffer), ",\"bestmove\":null,\"score\":%d}\n", inCheck(board) ? -MATE_SCORE : 0);
+        return json + buffer;
+    }
+
+    int mate = result.score >= MATE_BOUND ? (MATE_SCORE - result.score + 1) / 2 :
+               result.score <= -MATE_BOUND ? -(MATE_SCORE + result.score) / 2 : 0;
+
+    snprintf(buffer, sizeof(buffer), ",\"bestmove\":\"%s\",\"%s\":%d,\"depth\":%d,\"nodes\":%llu,\"time_ms\":%.3f}\n",
+             moveToString(result.bestMove, moveString), mate ? "mate" : "score", mate ? mate : result.score,
+             result.depth, result.nodes, result.timeNs / 1e6);
+    return json + buffer;
+}
+
+// stream FEN/EPD lines from input through a pool of worker threads, writing ordered JSONL to stdout
+// (every worker runs independent single threaded searches on its own hashMegabytes / threadCount table, cleared for
+// every job, so results only depend on the limits and that share, SEARCH_STATS builds end the output with a
+// {"stats":{...}} line of the whole run)
+void batchAnalysis(std::istream &input, int threadCount, const SearchLimits &limits, int perftDepth,
+                   int queueCapacity, int hashMegabytes) {
+    BatchPipeline pipeline(queueCapacity > 0 ? queueCapacity : 1);
+    long long start = getTimeNs();
+    U64 count = 0ULL;
+    StatsTotals stats;
+
+    auto worker = [&]() {
+        SearchState *search = new SearchState();
+        CBoard *board = new CBoard();
+        BatchJob job;
+
+        TranspositionTable *table = new TranspositionTable();
+        if (perftDepth <= 0) table->resize(std::max(hashMegabytes / threadCount, 1));
+        search->tt = table;
+
+        while (pipeline.pop(job)) {
+            pipeline.finish(job.index, analyseBatchLine(*search, *board, job, limits, perftDepth));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pipeline.mutex);
+            stats += search->stats;
+        }
+
+        delete board;
+        delete search;
+        delete table;
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(worker);
+    }
+
+    // blank lines and # comments are skipped
+    std::string line;
+    while (std::getline(input, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        pipeline.push({count++, std::move(line)});
+    }
+
+    pipeline.close();
+    for (std::thread &thread : workers) {
+        thread.join();
+    }
+
+#if SEARCH_STATS_ENABLED
+    // search stats of the whole run as last line
+    if (perftDepth <= 0) {
+        printf("{\"stats\":%s}\n", statsToJson(stats).c_str());
+    }
+#endif
+    fflush(stdout);
+
+    long long elapsed = getTimeNs() - start;
+    fprintf(stderr, "batch: %llu positions  threads: %d  time: %.3f s  positions/s: %.1f\n", count, threadCount,
+            elapsed / 1e9, elapsed ? count * 1e9 / elapsed : 0.0);
+}
+
+// fixed positions searched by the search benchmarks
+const char *benchPositions[] = {
+        START_POSITION,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r2q1rk1/ppp2ppp/2n1bn2/2bpp3/4P3/2PP1NP1/PP1NBPBP/R2QK2R w KQ - 0 9",
+        "r1bq1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+#define BENCH_POSITION_COUNT ((int) (sizeof(benchPositions) / sizeof(benchPositions[0])))
+
+// lazy smp scaling benchmark: time to depth and nps of the bench positions for 1 to maxThreads threads
+void benchSmpScaling(int maxThreads, int depth) {
+    SearchLimits limits;
+    limits.depth = depth;
+
+    long long baseTime = 0;
+    double baseNps = 0.0;
+
+    printf("\n  %-7s %12s %10s %12s %8s %8s\n", "threads", "nodes", "time", "nps", "ttd x", "nps x");
+
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        U64 nodes = 0ULL;
+        long long time = 0;
+
+        for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+            CBoard board;
+            board.parseFen(benchPositions[i]);
+
+            // every position starts from an empty table
+            transpositionTable.clear();
+            mainSearch.stopped = false;
+
+            SearchResult result = searchPosition(mainSearch, board, limits, threads, false);
+            nodes += result.nodes;
+            time += result.timeNs;
+        }
+
+        double nps = time ? nodes * 1e9 / time : 0.0;
+        if (threads == 1) {
+            baseTime = time;
+            baseNps = nps;
+        }
+
+        printf("  %-7d %12llu %8.3f s %12.0f %8.2f %8.2f\n", threads, nodes, time / 1e9, nps,
+               time ? (double) baseTime / time : 0.0, baseNps ? nps / baseNps : 0.0);
+    }
+
+    printf("\n");
+}
+
+// attack tables and the kpk bitbase are generated at compile time, only slider and network backends are picked and
+// the transposition table sized at runtime (a network is only loaded when EvalFile or evalfile <file> names one)
+void init_all() {
+    sliderBackend = selectSliderBackend();
+    setNnueBackend(selectNnueBackend());
+    transpositionTable.resize(DEFAULT_HASH_MB);
+}
+
+/*********************\
+ ======================
+       Benchmarks
+ ======================
+\*********************/
+
+// legacy fixed size slider attack tables, kept for layout comparison only
+static U64 (*legacyBishopAttacks)[512];
+static U64 (*legacyRookAttacks)[4096];
+
+// get bishop attacks from legacy table layout
+static inline U64 getLegacyBishopAttacks(int square, U64 occupancy) {
+    occupancy &= bishopMasks[square];
+    occupancy *= bishopMagicNumbers[square];
+    occupancy >>= 64 - bishopRelevantBits[square];
+
+    return legacyBishopAttacks[square][occupancy];
+}
+
+// get rook attacks from legacy table layout
+static inline U64 getLegacyRookAttacks(int square, U64 occupancy) {
+    occupancy &= rookMasks[square];
+    occupancy *= rookMagicNumbers[square];
+    occupancy >>= 64 - rookRelevantBits[square];
+
+    return legacyRookAttacks[square][occupancy];
+}
+
+// compare slider lookup throughput of packed and legacy attack table layouts
+void benchSliderAttacks() {
+    // number of lookup samples and passes over them
+    const int samples = 1 << 16;
+    const int passes = 256;
+
+    // remember backend chosen at startup
+    int selectedBackend = sliderBackend;
+
+    // build legacy tables from packed magic ones (magic indices are the same)
+    legacyBishopAttacks = new U64[64][512]();
+    legacyRookAttacks = new U64[64][4096]();
+
+    for (int square = 0; square < 64; square++) {
+        for (int i = 0; i < (1 << bishopRelevantBits[square]); i++) {
+            legacyBishopAttacks[square][i] = magicSliderAttacks.attacks[magicSliderAttacks.bishopOffsets[square] + i];
+        }
+        for (int i = 0; i < (1 << rookRelevantBits[square]); i++) {
+            legacyRookAttacks[square][i] = magicSliderAttacks.attacks[magicSliderAttacks.rookOffsets[square] + i];
+        }
+    }
+
+    // init lookup samples with a local xorshift so the magic search state is untouched
+    int *squares = new int[samples];
+    U64 *occupancies = new U64[samples];
+    U64 state = 0x9E3779B97F4A7C15ULL;
+
+    for (int i = 0; i < samples; i++) {
+        U64 r[2];
+        for (U64 &n : r) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            n = state;
+        }
+        squares[i] = (int) (r[0] & 63);
+        // sparse occupancy, roughly a quarter of the squares set
+        occupancies[i] = r[0] & r[1];
+    }
+
+    printf("\n  packed table:  %7zu KB\n", sizeof(magicSliderAttacks.attacks) / 1024);
+    printf("  legacy table:  %7zu KB\n\n", (sizeof(U64[64][512]) + sizeof(U64[64][4096])) / 1024);
+
+    // time packed layout with every supported backend, then legacy layout
+    for (int layout = 0; layout < 3; layout++) {
+        if (layout == pextSliders && !cpuHasBmi2()) {
+            printf("  pext   packed: not supported by cpu\n");
+            continue;
+        }
+
+        // legacy layout uses magic indices
+        sliderBackend = layout == 2 ? magicSliders : layout;
+
+        U64 checksum = 0ULL;
+        long long start = getTimeNs();
+
+        for (int pass = 0; pass < passes; pass++) {
+            for (int i = 0; i < samples; i++) {
+                if (layout == 2) {
+                    checksum += getLegacyRookAttacks(squares[i], occupancies[i]);
+                    checksum += getLegacyBishopAttacks(squares[i], occupancies[i]);
+                }
+                else {
+                    checksum += getRookAttacks(squares[i], occupancies[i]);
+                    checksum += getBishopAttacks(squares[i], occupancies[i]);
+                }
+            }
+        }
+
+        long long elapsed = getTimeNs() - start;
+        double lookups = 2.0 * samples * passes;
+
+        printf("  %s: %8.2f M lookups/s  %6.2f ns/lookup  (checksum %llx)\n",
+               layout == 2 ? "magic  legacy" : layout ? "pext   packed" : "magic  packed",
+               lookups * 1e3 / elapsed, elapsed / lookups, checksum);
+    }
+
+    // restore startup backend
+    sliderBackend = selectedBackend;
+
+    printf("\n  startup backend: %s\n", sliderBackendNames[sliderBackend]);
+
+    delete[] squares;
+    delete[] occupancies;
+    delete[] legacyBishopAttacks;
+    delete[] legacyRookAttacks;
+}
+
+// loop based bit count, kept as benchmark reference
+static inline int countBitsLoop(U64 bitboard) {
+    int count = 0;
+    while (bitboard) {
+        bitboard &= bitboard - 1;
+        count++;
+    }
+    return count;
+}
+
+// loop based bit scan, kept as benchmark reference
+static inline int ls1bIndexLoop(U64 bitboard) {
+    return bitboard ? countBitsLoop((bitboard & -bitboard) - 1) : -1;
+}
+
+// compare nanoseconds per call of loop based and intrinsic bit tricks
+void benchBitTricks() {
+    const int samples = 1 << 16;
+    const int passes = 128;
+
+    // random bitboards of mixed density (sparse to dense, never empty)
+    U64 *bitboards = new U64[samples];
+    U64 state = 0x9E3779B97F4A7C15ULL;
+
+    for (int i = 0; i < samples; i++) {
+        U64 r[3];
+        for (U64 &n : r) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            n = state;
+        }
+        bitboards[i] = (i & 1 ? r[0] & r[1] & r[2] : r[0] | r[1]) | (1ULL << (r[2] >> 58));
+    }
+
+    // number of set bits over all samples
+    long long totalBits = 0;
+    for (int i = 0; i < samples; i++) totalBits += countBits(bitboards[i]);
+
+    printf("\n");
+
+    // time a bit trick over all samples and print nanoseconds per call
+    auto timeCalls = [&](const char *name, long long callsPerPass, auto bitTrick) {
+        long long checksum = 0;
+        long long start = getTimeNs();
+
+        for (int pass = 0; pass < passes; pass++) {
+            for (int i = 0; i < samples; i++) {
+                checksum += bitTrick(bitboards[i]);
+            }
+        }
+
+        long long elapsed = getTimeNs() - start;
+
+        printf("  %-26s %6.2f ns/call  (checksum %lld)\n", name,
+               elapsed / ((double) passes * callsPerPass), checksum);
+    };
+
+    timeCalls("countBits      loop", samples, [](U64 bitboard) {
+        return (long long) countBitsLoop(bitboard);
+    });
+    timeCalls("countBits      intrinsic", samples, [](U64 bitboard) {
+        return (long long) countBits(bitboard);
+    });
+    timeCalls("ls1bIndex      loop", samples, [](U64 bitboard) {
+        return (long long) ls1bIndexLoop(bitboard);
+    });
+    timeCalls("ls1bIndex      intrinsic", samples, [](U64 bitboard) {
+        return (long long) ls1bIndex(bitboard);
+    });
+
+    // bit iteration is timed per popped bit
+    timeCalls("bit iteration  loop", totalBits, [](U64 bitboard) {
+        // classic ls1bIndex + pop_bit iteration
+        long long sum = 0;
+        while (bitboard) {
+            int square = ls1bIndexLoop(bitboard);
+            sum += square;
+            pop_bit(bitboard, square);
+        }
+        return sum;
+    });
+    timeCalls("bit iteration  fused pop", totalBits, [](U64 bitboard) {
+        // fused pop LS1B iteration
+        long long sum = 0;
+        while (bitboard) {
+            sum += popLs1bIndex(bitboard);
+        }
+        return sum;
+    });
+
+    delete[] bitboards;
+}
+
+// default search depth of the bench command
+#define BENCH_DEPTH 6
+
+// stride between kpk bitbase positions checked against the move generator by bench
+#define KPK_CHECK_STRIDE 13
+
+// does white win after move (bitbase lookup, a lost pawn draws, a queen promotion wins unless the queen is taken)
+bool kpkWinsAfter(CBoard &board, Move move) {
+    board.makeMove(move);
+
+    bool wins = isKpk(board) && kpkProbe(board);
+    if (is_promotion(move)) {
+        MoveList replies;
+        generateMoves(board, replies);
+
+        wins = true;
+        for (int i = 0; i < replies.count; i++) {
+            if (get_move_target(replies.moves[i]) == get_move_target(move)) wins = false;
+        }
+    }
+
+    board.unmakeMove(move);
+    return wins;
+}
+
+// check every KPK_CHECK_STRIDE-th bitbase position against one ply of real move generation: white to move wins if
+// one of its moves wins, black to move loses if it has moves and all of them lose, returns the mismatches
+int checkKpkBitbase(int &checked) {
+    CBoard *board = new CBoard();
+    int mismatches = 0;
+    checked = 0;
+
+    for (int index = 0; index < KPK_SIZE; index += KPK_CHECK_STRIDE) {
+        int blackKing = index & 63;
+        int side = (index >> 6) & 1;
+        int whiteKing = (index >> 7) & 63;
+        int pawnSquare = ((index >> 13) & 3) + 8 * ((index >> 15) + 1);
+
+        // fen of the position, kings on the same square or next to each other are rejected by the parser
+        char squares[64], fen[96];
+        int length = 0;
+        memset(squares, 0, sizeof(squares));
+        squares[pawnSquare] = 'P';
+        squares[whiteKing] = 'K';
+        squares[blackKing] = 'k';
+
+        for (int rank = 0; rank < 8; rank++) {
+            for (int file = 0, empty = 0; file < 8; file++) {
+                char piece = squares[rank * 8 + file];
+                if (!piece) empty++;
+                if (empty && (piece || file == 7)) fen[length++] = (char) ('0' + empty);
+                if (piece) {
+                    fen[length++] = piece;
+                    empty = 0;
+                }
+            }
+            fen[length++] = rank < 7 ? '/' : ' ';
+        }
+        snprintf(fen + length, sizeof(fen) - length, "%c - - 0 1", side == white ? 'w' : 'b');
+
+        if (!board->parseFen(fen) || !isKpk(*board)) continue;
+
+        MoveList list;
+        generateMoves(*board, list);
+
+        bool wins;
+        if (side == white) {
+            wins = false;
+            for (int i = 0; i < list.count; i++) wins |= kpkWinsAfter(*board, list.moves[i]);
+        }
+        else {
+            wins = list.count || inCheck(*board);
+            for (int i = 0; i < list.count; i++) wins &= kpkWinsAfter(*board, list.moves[i]);
+        }
+
+        mismatches += wins != kpkProbe(*board);
+        checked++;
+    }
+
+    delete board;
+    return mismatches;
+}
+
+// time startup phases: the attack tables are compile time constants, their generators are run again at runtime
+// here to show what generating them at startup would cost, returns whether they and the polyglot keys check out
+bool benchStartupPhases() {
+    long long start = getTimeNs();
+    LeaperAttacks *leapers = new LeaperAttacks(init_leaper_attacks());
+    long long leaperTime = getTimeNs() - start;
+
+    start = getTimeNs();
+    auto *magicTables = new SliderAttacks<sliderTableSize(magicSliders)>(
+            init_slider_attacks<sliderTableSize(magicSliders)>(magicSliders));
+    long long magicTime = getTimeNs() - start;
+
+    start = getTimeNs();
+    auto *pextTables = new SliderAttacks<sliderTableSize(pextSliders)>(
+            init_slider_attacks<sliderTableSize(pextSliders)>(pextSliders));
+    long long pextTime = getTimeNs() - start;
+
+    // generated tables must match the compile time ones
+    int match = !memcmp(leapers, &leaperAttacks, sizeof(LeaperAttacks)) &&
+                !memcmp(magicTables, &magicSliderAttacks, sizeof(magicSliderAttacks)) &&
+                !memcmp(pextTables, &pextSliderAttacks, sizeof(pextSliderAttacks));
+
+    start = getTimeNs();
+    KpkBitbase *kpk = new KpkBitbase(init_kpk_bitbase());
+    long long kpkTime = getTimeNs() - start;
+
+    start = getTimeNs();
+    int kpkChecked = 0;
+    int kpkMismatches = checkKpkBitbase(kpkChecked);
+    long long kpkCheckTime = getTimeNs() - start;
+
+    match = match && !memcmp(kpk, &kpkBitbase, sizeof(KpkBitbase)) && !kpkMismatches;
+
+    int kpkWins = 0;
+    for (U64 bits : kpkBitbase.wins) kpkWins += countBits(bits);
+    delete kpk;
+
+    bool polyglotKeys = checkPolyglotRandom();
+
+    start = getTimeNs();
+    init_all();
+    long long initTime = getTimeNs() - start;
+
+    printf("  init_leaper_attacks:          %9.3f ms (compile time in this build)\n", leaperTime / 1e6);
+    printf("  init_slider_attacks (magic):  %9.3f ms (compile time in this build)\n", magicTime / 1e6);
+    printf("  init_slider_attacks (pext):   %9.3f ms (compile time in this build)\n", pextTime / 1e6);
+    printf("  init_kpk_bitbase:             %9.3f ms (compile time in this build, %d wins)\n", kpkTime / 1e6, kpkWins);
+    printf("  checkKpkBitbase:              %9.3f ms (%d positions, %d mismatches)\n", kpkCheckTime / 1e6,
+           kpkChecked, kpkMismatches);
+    printf("  init_all:                     %9.3f ms (backend selection, %d MB hash)\n",
+           initTime / 1e6, DEFAULT_HASH_MB);
+    printf("  runtime tables match:         %s\n", match ? "yes" : "NO");
+    printf("  polyglot reference keys:      %s\n\n", polyglotKeys ? "yes" : "NO");
+
+    delete leapers;
+    delete magicTables;
+    delete pextTables;
+    return match && polyglotKeys;
+}
+
+// handcrafted evaluation times through the pawn hash table and without it
+struct PawnEvalTiming {
+    U64 nodes = 0ULL;
+    long long cachedNs = 0;
+    long long scratchNs = 0;
+};
+
+// evaluate every node of the tree below board with and without the pawn hash table
+void timePawnEvalNode(CBoard &board, int depth, PawnEvalTiming &timing) {
+    long long start = getTimeNs();
+    int cached = evaluateHandcrafted<true>(board);
+    timing.cachedNs += getTimeNs() - start;
+
+    start = getTimeNs();
+    int scratch = evaluateHandcrafted<false>(board);
+    timing.scratchNs += getTimeNs() - start;
+
+    timing.nodes++;
+    if (cached != scratch) {
+        fprintf(stderr, "pawn hash eval mismatch: %d, expected %d\n", cached, scratch);
+        abort();
+    }
+
+    if (!depth) return;
+
+    MoveList list;
+    generateMoves(board, list);
+
+    for (int i = 0; i < list.count; i++) {
+        board.makeMove(list.moves[i]);
+        timePawnEvalNode(board, depth - 1, timing);
+        board.unmakeMove(list.moves[i]);
+    }
+}
+
+// search the bench positions to fixed depth on one thread from an empty hash table
+// the total node count is a signature of search behaviour, returns false if it differs from expected (0 = any)
+bool benchSearch(int depth, U64 expected) {
+    SearchLimits limits;
+    limits.depth = depth;
+
+    printf("\n");
+    bool tablesPassed = benchStartupPhases();
+
+    // the signature is defined by the handcrafted evaluation
+    unloadNetwork();
+
+    U64 nodes = 0ULL;
+    long long time = 0;
+    pawnHashTable.clear();
+
+    for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+        CBoard *board = new CBoard();
+        board->parseFen(benchPositions[i]);
+
+        transpositionTable.clear();
+        mainSearch.stopped = false;
+        mainSearch.pondering = false;
+
+        SearchResult result = searchPosition(mainSearch, *board, limits, 1, false);
+        nodes += result.nodes;
+        time += result.timeNs;
+
+        printf("  %-3d %12llu nodes %9.3f ms  %s\n", i + 1, result.nodes, result.timeNs / 1e6, benchPositions[i]);
+        delete board;
+    }
+
+    printf("\n  depth:      %d\n", depth);
+    printf("  signature:  %llu\n", nodes);
+    printf("  time:       %.3f s\n", time / 1e9);
+    printf("  nps:        %.0f\n", time ? nodes * 1e9 / time : 0.0);
+
+    // pawn hash table hits of the searches, handcrafted eval time with and without it over the position trees
+    printf("  pawn hash:  %.2f%% hits of %llu probes\n",
+           pawnHashTable.probes ? 100.0 * pawnHashTable.hits / pawnHashTable.probes : 0.0, pawnHashTable.probes);
+
+    PawnEvalTiming timing;
+    CBoard *board = new CBoard();
+    pawnHashTable.clear();
+
+    for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+        board->parseFen(benchPositions[i]);
+        timePawnEvalNode(*board, 3, timing);
+    }
+    delete board;
+
+    double cached = (double) timing.cachedNs / timing.nodes;
+    double scratch = (double) timing.scratchNs / timing.nodes;
+    printf("  eval:       %.1f ns cached, %.1f ns uncached (%.0f%% saved, %.2f%% hits over %llu nodes)\n",
+           cached, scratch, scratch > 0 ? 100.0 * (scratch - cached) / scratch : 0.0,
+           100.0 * pawnHashTable.hits / pawnHashTable.probes, timing.nodes);
+
+    if (expected && nodes != expected) {
+        printf("  expected:   %llu  SIGNATURE MISMATCH\n\n", expected);
+        return false;
+    }
+
+    printf("\n");
+    return tablesPassed;
+}
+
+// compare slider attack map kernels on the bench positions and their children (both sides)
+void benchAttackMaps() {
+    const int passes = 2000;
+
+    // slider sets and occupancy of every sample
+    struct FillSample {
+        U64 lines, diagonals, occupancy;
+    };
+    std::vector<FillSample> samples;
+
+    CBoard *board = new CBoard();
+    for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+        board->parseFen(benchPositions[i]);
+
+        MoveList list;
+        generateMoves(*board, list);
+
+        for (int j = -1; j < list.count; j++) {
+            if (j >= 0) board->makeMove(list.moves[j]);
+
+            for (int side = white; side <= black; side++) {
+                samples.push_back({board->pieces[side][rook] | board->pieces[side][queen],
+                                   board->pieces[side][bishop] | board->pieces[side][queen],
+                                   board->occupancies[both]});
+            }
+
+            if (j >= 0) board->unmakeMove(list.moves[j]);
+        }
+    }
+    delete board;
+
+    printf("\n");
+    int preferred = selectFillBackend();
+    printf("  %d attack maps, preferred backend: %s\n\n", (int) samples.size(), fillBackendNames[preferred]);
+
+    for (int backend = magicLoopFill; backend <= koggeStoneAvx2Fill; backend++) {
+        if (backend == koggeStoneAvx2Fill && !cpuHasAvx2()) {
+            printf("  %-18s not supported by cpu\n", fillBackendNames[backend]);
+            continue;
+        }
+
+        SliderFillKernel kernel = sliderFillKernel(backend);
+
+        // every kernel must agree with the magic lookups
+        int mismatches = 0;
+        for (const FillSample &sample : samples) {
+            mismatches += kernel(sample.lines, sample.diagonals, sample.occupancy) !=
+                          sliderAttacksMagicLoop(sample.lines, sample.diagonals, sample.occupancy);
+        }
+
+        U64 checksum = 0ULL;
+        long long start = getTimeNs();
+
+        for (int pass = 0; pass < passes; pass++) {
+            for (const FillSample &sample : samples) {
+                checksum += kernel(sample.lines, sample.diagonals, sample.occupancy);
+            }
+        }
+
+        long long elapsed = getTimeNs() - start;
+
+        printf("  %-18s %6.2f ns/map  mismatches: %d  (checksum %llx)\n", fillBackendNames[backend],
+               elapsed / ((double) passes * samples.size()), mismatches, checksum);
+    }
+
+    printf("\n");
+}
+
+// write a test network: the material balance (carried through the first neuron of every layer) plus random weights
+// everywhere else, so searches with it behave sanely (exercises the network code, it doesn't play well)
+bool writeRandomNetwork(const char *path, unsigned int seed) {
+    std::vector<char> file(nnueLayout.size, 0);
+    char *base = file.data();
+    unsigned int state = seed ? seed : randomState;
+
+    auto random = [&](int low, int high) {
+        return low + (int) (getRandomU32Number(state) % (unsigned int) (high - low + 1));
+    };
+
+    NnueHeader header{};
+    memcpy(header.magic, NNUE_MAGIC, 8);
+    header.features = NNUE_FEATURES;
+    header.hidden = NNUE_HIDDEN;
+    header.l2 = NNUE_L2;
+    header.l3 = NNUE_L3;
+    memcpy(base, &header, sizeof(header));
+
+    int16_t *transformerBiases = (int16_t *) (base + nnueLayout.transformerBiases);
+    int16_t *transformerWeights = (int16_t *) (base + nnueLayout.transformerWeights);
+    int32_t *l2Biases = (int32_t *) (base + nnueLayout.l2Biases);
+    int8_t *l2Weights = (int8_t *) (base + nnueLayout.l2Weights);
+    int32_t *l3Biases = (int32_t *) (base + nnueLayout.l3Biases);
+    int8_t *l3Weights = (int8_t *) (base + nnueLayout.l3Weights);
+    int8_t *outputWeights = (int8_t *) (base + nnueLayout.outputWeights);
+
+    // transformer: neuron 0 counts own material in 1/32 pawns (the start position has 120), the others are noise
+    // mostly inside the clipped relu range
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+        transformerBiases[i] = (int16_t) (i ? random(0, 64) : 0);
+    }
+    for (int feature = 0; feature < NNUE_FEATURES; feature++) {
+        int kind = feature / 64 % 10;
+        transformerWeights[(size_t) feature * NNUE_HIDDEN] = (int16_t) (kind < 5 ? materialScore[kind] / 32 : 0);
+
+        for (int i = 1; i < NNUE_HIDDEN; i++) {
+            transformerWeights[(size_t) feature * NNUE_HIDDEN + i] = (int16_t) random(-8, 8);
+        }
+    }
+
+    // hidden layer 1: neuron 0 is 64 + own material - their material
+    for (int i = 0; i < NNUE_L2; i++) {
+        l2Biases[i] = i ? random(-2048, 2048) : 64 << NNUE_SHIFT;
+
+        for (int j = 0; j < 2 * NNUE_HIDDEN; j++) {
+            l2Weights[i * 2 * NNUE_HIDDEN + j] = (int8_t) (i ? random(-4, 4) : j == 0 ? 64 : j == NNUE_HIDDEN ? -64 : 0);
+        }
+    }
+
+    // hidden layer 2: neurons 0 to 7 copy the material neuron
+    for (int i = 0; i < NNUE_L3; i++) {
+        l3Biases[i] = i < 8 ? 0 : random(-2048, 2048);
+
+        for (int j = 0; j < NNUE_L2; j++) {
+            l3Weights[i * NNUE_L2 + j] = (int8_t) (i >= 8 ? random(-32, 32) : j == 0 ? 64 : 0);
+        }
+    }
+
+    // output: 32 centipawns per material unit plus some noise
+    *(int32_t *) (base + nnueLayout.outputBias) = -8 * 64 * 64;
+    for (int i = 0; i < NNUE_L3; i++) {
+        outputWeights[i] = (int8_t) (i < 8 ? 64 : random(-2, 2));
+    }
+
+    std::ofstream output(path, std::ios::binary);
+    return output.write(base, (std::streamsize) file.size()).good();
+}
+
+// network check totals
+struct NetworkCheck {
+    U64 nodes = 0ULL;
+    U64 mismatches = 0ULL;
+    U64 kernelMismatches = 0ULL;
+    long long incrementalNs = 0;
+    long long scratchNs = 0;
+};
+
+// evaluate every node of the tree below board incrementally, from scratch and with both propagation kernels
+void checkNetworkNode(CBoard &board, int depth, NetworkCheck &check) {
+    long long start = getTimeNs();
+    int incremental = nnueEvaluate(board);
+    check.incrementalNs += getTimeNs() - start;
+
+    start = getTimeNs();
+    int scratch = nnueEvaluateFromScratch(board);
+    check.scratchNs += getTimeNs() - start;
+
+    check.nodes++;
+    check.mismatches += incremental != scratch;
+
+#if AVX2_SUPPORTED
+    const NnueAccumulator &accumulator = board.accumulator;
+    if (cpuHasAvx2()) {
+        check.kernelMismatches +=
+                nnuePropagateAvx2(accumulator.values[board.side], accumulator.values[board.side ^ 1]) !=
+                nnuePropagateScalar(accumulator.values[board.side], accumulator.values[board.side ^ 1]);
+    }
+#endif
+
+    if (!depth) return;
+
+    MoveList list;
+    generateMoves(board, list);
+
+    for (int i = 0; i < list.count; i++) {
+        board.makeMove(list.moves[i]);
+        checkNetworkNode(board, depth - 1, check);
+        board.unmakeMove(list.moves[i]);
+    }
+}
+
+// check incremental network evaluation against full recomputes over the bench position trees, and time both
+void checkNetwork(int depth) {
+    if (!nnueActive) {
+        printf("\n  no network loaded\n\n");
+        return;
+    }
+
+    NetworkCheck check;
+    CBoard *board = new CBoard();
+
+    for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+        board->parseFen(benchPositions[i]);
+        checkNetworkNode(*board, depth, check);
+    }
+    delete board;
+
+    printf("\n  kernels:                 %s\n", nnueBackendNames[nnueBackend]);
+    printf("  nodes:                   %llu\n", check.nodes);
+    printf("  incremental mismatches:  %llu\n", check.mismatches);
+    printf("  kernel mismatches:       %llu\n", check.kernelMismatches);
+    printf("  incremental eval:        %.1f ns/node\n", (double) check.incrementalNs / check.nodes);
+    printf("  full eval:               %.1f ns/node\n\n", (double) check.scratchNs / check.nodes);
+}
+
+/*********************\
+ ======================
+      Main Driver
+ ======================
+\*********************/
+
+// the microbenchmark executable includes this file for its primitives and brings its own main
+#ifndef CHESS_ENGINE_NO_MAIN
+int main(int argc, char *argv[]) {
+    // init all variables
+    init_all();
+
+    // run slider attack lookup benchmark
+    if (argc > 1 && !strcmp(argv[1], "sliderbench")) {
+        benchSliderAttacks();
+        return 0;
+    }
+
+    // bench [depth] [expect <signature>]
+    if (argc > 1 && !strcmp(argv[1], "bench")) {
+        int depth = BENCH_DEPTH;
+        U64 expected = 0ULL;
+
+        for (int i = 2; i < argc; i++) {
+            if (!strcmp(argv[i], "expect") && i + 1 < argc) expected = strtoull(argv[++i], nullptr, 10);
+            else depth = atoi(argv[i]);
+        }
+
+        return benchSearch(depth > 0 ? depth : BENCH_DEPTH, expected) ? 0 : 1;
+    }
+
+    // run slider attack map kernel benchmark
+    if (argc > 1 && !strcmp(argv[1], "fillbench")) {
+        benchAttackMaps();
+        return 0;
+    }
+
+    // network tools: nnue random <file> [seed] writes a test network, nnue check <file> [depth] checks one
+    if (argc > 2 && !strcmp(argv[1], "nnue")) {
+        if (!strcmp(argv[2], "random") && argc > 3) {
+            unsigned int seed = argc > 4 ? (unsigned int) strtoul(argv[4], nullptr, 10) : 0;
+            if (!writeRandomNetwork(argv[3], seed)) {
+                fprintf(stderr, "cannot write %s\n", argv[3]);
+                return 1;
+            }
+            return 0;
+        }
+
+        if (!strcmp(argv[2], "check") && argc > 3) {
+            if (!loadNetworkArgument(argv[3])) return 1;
+            checkNetwork(argc > 4 ? atoi(argv[4]) : 3);
+            return 0;
+        }
+    }
+
+    // book tools: book build <pgn> <book> [plies] builds a polyglot book, book probe <book> [fen] lists its moves
+    if (argc > 3 && !strcmp(argv[1], "book")) {
+        if (!strcmp(argv[2], "build") && argc > 4) {
+            return buildBook(argv[3], argv[4], argc > 5 ? atoi(argv[5]) : BOOK_BUILD_PLIES) ? 0 : 1;
+        }
+
+        if (!strcmp(argv[2], "probe")) {
+            if (!loadBook(argv[3])) {
+                fprintf(stderr, "cannot load book %s\n", argv[3]);
+                return 1;
+            }
+
+            std::string fen;
+            for (int i = 4; i < argc; i++) fen += std::string(argv[i]) + " ";
+
+            CBoard *board = new CBoard();
+            if (!board->parseFen(fen.empty() ? START_POSITION : fen.c_str())) {
+                fprintf(stderr, "invalid fen %s\n", fen.c_str());
+                delete board;
+                return 1;
+            }
+
+            printBookMoves(*board);
+            delete board;
+            return 0;
+        }
+    }
+
+    // run bit manipulation benchmark
+    if (argc > 1 && !strcmp(argv[1], "bitbench")) {
+        benchBitTricks();
+        return 0;
+    }
+
+    // perft <depth> [threads <n>] [hash <mb>] [fen] / divide <depth> [threads <n>] [hash <mb>] [fen]
+    if (argc > 2 && (!strcmp(argv[1], "perft") || !strcmp(argv[1], "divide"))) {
+        int threadCount = 1;
+
+        // FEN may be passed as one or several arguments
+        std::string fen;
+        for (int i = 3; i < argc; i++) {
+            if (!strcmp(argv[i], "threads") && i + 1 < argc) {
+                threadCount = atoi(argv[++i]);
+                continue;
+            }
+            if (!strcmp(argv[i], "hash") && i + 1 < argc) {
+                perftHashTable.resize(atoi(argv[++i]));
+                continue;
+            }
+            fen += argv[i];
+            fen += ' ';
+        }
+
+        CBoard board;
+        if (!board.parseFen(fen.empty() ? START_POSITION : fen.c_str())) {
+            printf("invalid FEN: %s\n", fen.c_str());
+            return 1;
+        }
+
+        perftTest(board, atoi(argv[2]), !strcmp(argv[1], "divide"), threadCount > 0 ? threadCount : 1);
+        return 0;
+    }
+
+    // perftsuite [max depth] [threads <n>] [hash <mb>]
+    if (argc > 1 && !strcmp(argv[1], "perftsuite")) {
+        int depthLimit = 0, threadCount = 1;
+
+        for (int i = 2; i < argc; i++) {
+            if (!strcmp(argv[i], "threads") && i + 1 < argc) threadCount = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "hash") && i + 1 < argc) perftHashTable.resize(atoi(argv[++i]));
+            else depthLimit = atoi(argv[i]);
+        }
+
+        return perftSuiteTest(depthLimit, threadCount > 0 ? threadCount : 1) ? 1 : 0;
+    }
+
+    // search <depth> [threads <n>] [hash <mb>] [nodes <n>] [movetime <ms>] [evalfile <file>] [fen]
+    if (argc > 2 && !strcmp(argv[1], "search")) {
+        SearchLimits limits;
+        limits.depth = atoi(argv[2]);
+
+        std::string fen;
+        for (int i = 3; i < argc; i++) {
+            if (!strcmp(argv[i], "hash") && i + 1 < argc) transpositionTable.resize(atoi(argv[++i]));
+            else if (!strcmp(argv[i], "threads") && i + 1 < argc) searchThreadCount = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "nodes") && i + 1 < argc) limits.nodes = strtoull(argv[++i], nullptr, 10);
+            else if (!strcmp(argv[i], "movetime") && i + 1 < argc) limits.movetime = atoll(argv[++i]);
+            else if (!strcmp(argv[i], "evalfile") && i + 1 < argc) {
+                if (!loadNetworkArgument(argv[++i])) return 1;
+            }
+            else {
+                fen += argv[i];
+                fen += ' ';
+            }
+        }
+
+        CBoard board;
+        if (!board.parseFen(fen.empty() ? START_POSITION : fen.c_str())) {
+            printf("invalid FEN: %s\n", fen.c_str());
+            return 1;
+        }
+
+        mainSearch.stopped = false;
+        searchPosition(mainSearch, board, limits, searchThreadCount);
+        return 0;
+    }
+
+    // batch [file] [depth <n> | nodes <n> | perft <n>] [threads <n>] [hash <mb>] [queue <n>] [evalfile <file>]
+    // (hash is split between the threads)
+    if (argc > 1 && !strcmp(argv[1], "batch")) {
+        SearchLimits limits;
+        int perftDepth = 0, queueCapacity = 256, hashMegabytes = DEFAULT_HASH_MB;
+        int threadCount = (int) std::thread::hardware_concurrency();
+        const char *path = nullptr;
+
+        for (int i = 2; i < argc; i++) {
+            if (!strcmp(argv[i], "depth") && i + 1 < argc) limits.depth = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "nodes") && i + 1 < argc) limits.nodes = strtoull(argv[++i], nullptr, 10);
+            else if (!strcmp(argv[i], "perft") && i + 1 < argc) perftDepth = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "threads") && i + 1 < argc) threadCount = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "hash") && i + 1 < argc) hashMegabytes = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "queue") && i + 1 < argc) queueCapacity = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "evalfile") && i + 1 < argc) {
+                if (!loadNetworkArgument(argv[++i])) return 1;
+            }
+            else path = argv[i];
+        }
+
+        // fixed default budget, a batch search must never run unbounded
+        if (!limits.depth && !limits.nodes) limits.depth = 6;
+
+        std::ifstream file;
+        if (path) {
+            file.open(path);
+            if (!file) {
+                fprintf(stderr, "cannot open %s\n", path);
+                return 1;
+            }
+        }
+
+        batchAnalysis(path ? file : std::cin, threadCount > 0 ? threadCount : 1, limits, perftDepth, queueCapacity,
+                      hashMegabytes);
+        return 0;
+    }
+
+    // smpbench [max threads] [depth <n>] [hash <mb>]
+    if (argc > 1 && !strcmp(argv[1], "smpbench")) {
+        int maxThreads = (int) std::thread::hardware_concurrency();
+        int depth = 9;
+
+        for (int i = 2; i < argc; i++) {
+            if (!strcmp(argv[i], "depth") && i + 1 < argc) depth = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "hash") && i + 1 < argc) transpositionTable.resize(atoi(argv[++i]));
+            else maxThreads = atoi(argv[i]);
+        }
+
+        benchSmpScaling(maxThreads > 0 ? maxThreads : 1, depth);
+        return 0;
+    }
+
+    // search magic numbers: magics [dense] [threads <n>] [seed <n>] [tries <n>]
+    if (argc > 1 && !strcmp(argv[1], "magics")) {
+        int threadCount = (int) std::thread::hardware_concurrency();
+        int dense = 0;
+        unsigned int seed = randomState;
+        long long maxTries = 100000000;
+
+        for (int i = 2; i < argc; i++) {
+            if (!strcmp(argv[i], "dense")) dense = 1;
+            else if (!strcmp(argv[i], "threads") && i + 1 < argc) threadCount = atoi(argv[++i]);
+            else if (!strcmp(argv[i], "seed") && i + 1 < argc) seed = (unsigned int) strtoul(argv[++i], nullptr, 10);
+            else if (!strcmp(argv[i], "tries") && i + 1 < argc) maxTries = atoll(argv[++i]);
+        }
+
+        initMagicNumbers(threadCount > 0 ? threadCount : 1, dense, seed, maxTries);
+        return 0;
+    }
+
+    // print slider attacks of example occupancy
+    if (argc > 1 && !strcmp(argv[1], "demo")) {
+        U64 occupancy = 0ULL;
+        set_bit(occupancy, c5);
+        set_bit(occupancy, d3);
+
+        printBitboard(occupancy);
+
+        printBitboard(getBishopAttacks(d4, occupancy));
+        printBitboard(getRookAttacks(e5, occupancy));
+
+        return 0;
+    }
 
-    printBitboard(getBishopAttacks(d4, occupancy));
-    printBitboard(getRookAttacks(e5, occupancy));
+    // no (or uci) command: talk uci on stdin / stdout
+    uciLoop();
 
     return 0;
 }
+#endif
@@ -0,0 +1,407 @@
+// microbenchmarks of the engine primitives in isolation, results are printed as json on stdout
+// usage: chess_engine_microbench [quick] [nomagics]
+//   quick     fewer repetitions (noisier, for smoke runs)
+//   nomagics  skip the per square findMagicNumber timings
+
+// reuse the engine translation unit without its main
+#define CHESS_ENGINE_NO_MAIN
+#include "main.cpp"
+
+/*********************\
+ ======================
+      Measurement
+ ======================
+\*********************/
+
+// results are summed into the sink so the compiler can't drop the timed work
+volatile U64 benchSink;
+
+// one timed primitive
+struct MicroResult {
+    std::string name;
+    double nsPerOp;
+    long long ops;
+};
+
+std::vector<MicroResult> microResults;
+
+// repetitions of every measurement, the fastest one is reported
+int microRepetitions = 5;
+
+// xorshift64 stream, independent of the magic search random state
+static inline U64 nextRandom(U64 &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// time ops operations of run (best of microRepetitions) and record them under name
+template <typename Run>
+void measure(const char *name, long long ops, Run run) {
+    double best = 1e300;
+
+    for (int repetition = 0; repetition < microRepetitions; repetition++) {
+        long long start = getTimeNs();
+        benchSink += run();
+        double elapsed = (double) (getTimeNs() - start);
+
+        if (elapsed < best) best = elapsed;
+    }
+
+    microResults.push_back({name, best / ops, ops});
+}
+
+/*********************\
+ ======================
+    Attack Lookups
+ ======================
+\*********************/
+
+// slider lookup sample: square and full board occupancy
+struct LookupSample {
+    int square;
+    U64 occupancy;
+};
+
+// bishop and rook samples taken from real positions
+std::vector<LookupSample> realisticBishopSamples;
+std::vector<LookupSample> realisticRookSamples;
+
+// collect slider samples of every position up to depth plies below board
+void collectRealisticSamples(CBoard &board, int depth) {
+    U64 occupancy = board.occupancies[both];
+
+    for (int color = white; color <= black; color++) {
+        U64 diagonals = board.pieces[color][bishop] | board.pieces[color][queen];
+        U64 lines = board.pieces[color][rook] | board.pieces[color][queen];
+
+        while (diagonals) realisticBishopSamples.push_back({popLs1bIndex(diagonals), occupancy});
+        while (lines) realisticRookSamples.push_back({popLs1bIndex(lines), occupancy});
+    }
+
+    if (!depth) return;
+
+    MoveList list;
+    generateMoves(board, list);
+
+    for (int i = 0; i < list.count; i++) {
+        board.makeMove(list.moves[i]);
+        collectRealisticSamples(board, depth - 1);
+        board.unmakeMove(list.moves[i]);
+    }
+}
+
+// random square and sparse random occupancy (roughly a quarter of the squares set)
+std::vector<LookupSample> randomSamples(int count, U64 &state) {
+    std::vector<LookupSample> samples(count);
+
+    for (LookupSample &sample : samples) {
+        U64 r0 = nextRandom(state), r1 = nextRandom(state);
+        sample.square = (int) (r0 & 63);
+        sample.occupancy = r0 & r1;
+    }
+
+    return samples;
+}
+
+// buffer larger than the last level cache, streamed through to evict the attack tables
+std::vector<char> evictionBuffer(32 << 20);
+
+// touch every cache line of the eviction buffer
+U64 evictCaches() {
+    U64 sum = 0;
+    for (size_t i = 0; i < evictionBuffer.size(); i += 64) {
+        sum += evictionBuffer[i]++;
+    }
+    return sum;
+}
+
+// time lookups of one slider over samples, hot: all samples again and again, cold: small batches after eviction
+template <int piece>
+void measureLookups(const char *backendName, const char *samplesName, const std::vector<LookupSample> &samples) {
+    const int hotPasses = 1024;
+    const int coldBatch = 256;
+    const int coldBatches = 32;
+
+    // hot cache: a small working set of samples looped many times
+    int hotCount = std::min((int) samples.size(), 1024);
+    std::string name = std::string(piece == bishop ? "getBishopAttacks" : "getRookAttacks") + " " + backendName +
+                       " " + samplesName;
+
+    measure((name + " hot").c_str(), (long long) hotCount * hotPasses, [&]() {
+        U64 checksum = 0ULL;
+        for (int pass = 0; pass < hotPasses; pass++) {
+            for (int i = 0; i < hotCount; i++) {
+                checksum += piece == bishop ? getBishopAttacks(samples[i].square, samples[i].occupancy)
+                                            : getRookAttacks(samples[i].square, samples[i].occupancy);
+            }
+        }
+        return checksum;
+    });
+
+    // cold cache: only lookups are timed, caches are flushed before every batch
+    double best = 1e300;
+    long long ops = (long long) coldBatch * coldBatches;
+
+    for (int repetition = 0; repetition < microRepetitions; repetition++) {
+        long long elapsed = 0;
+        size_t next = 0;
+
+        for (int batch = 0; batch < coldBatches; batch++) {
+            benchSink += evictCaches();
+
+            U64 checksum = 0ULL;
+            long long start = getTimeNs();
+            for (int i = 0; i < coldBatch; i++, next = (next + 7919) % samples.size()) {
+                checksum += piece == bishop ? getBishopAttacks(samples[next].square, samples[next].occupancy)
+                                            : getRookAttacks(samples[next].square, samples[next].occupancy);
+            }
+            elapsed += getTimeNs() - start;
+            benchSink += checksum;
+        }
+
+        if (elapsed < best) best = (double) elapsed;
+    }
+
+    microResults.push_back({name + " cold", best / ops, ops});
+}
+
+// slider lookups with every backend the cpu supports, random and realistic occupancies
+void benchLookups() {
+    U64 state = 0x9E3779B97F4A7C15ULL;
+    std::vector<LookupSample> random = randomSamples(1 << 16, state);
+
+    for (int i = 0; i < BENCH_POSITION_COUNT; i++) {
+        CBoard board;
+        board.parseFen(benchPositions[i]);
+        collectRealisticSamples(board, 2);
+    }
+
+    int selectedBackend = sliderBackend;
+
+    for (int backend : {magicSliders, pextSliders}) {
+        if (backend == pextSliders && !cpuHasBmi2()) continue;
+
+        sliderBackend = backend;
+        const char *backendName = sliderBackendNames[backend];
+
+        measureLookups<bishop>(backendName, "random", random);
+        measureLookups<rook>(backendName, "random", random);
+        measureLookups<bishop>(backendName, "realistic", realisticBishopSamples);
+        measureLookups<rook>(backendName, "realistic", realisticRookSamples);
+    }
+
+    sliderBackend = selectedBackend;
+}
+
+/*********************\
+ ======================
+      Bit Tricks
+ ======================
+\*********************/
+
+void benchBitPrimitives() {
+    const int samples = 1 << 16;
+    const int passes = 64;
+
+    // random bitboards of mixed density, never empty
+    U64 state = 0xD1B54A32D192ED03ULL;
+    std::vector<U64> bitboards(samples);
+    for (int i = 0; i < samples; i++) {
+        U64 r0 = nextRandom(state), r1 = nextRandom(state), r2 = nextRandom(state);
+        bitboards[i] = (i & 1 ? r0 & r1 & r2 : r0 | r1) | (1ULL << (r2 >> 58));
+    }
+
+    measure("countBits", (long long) samples * passes, [&]() {
+        U64 checksum = 0ULL;
+        for (int pass = 0; pass < passes; pass++) {
+            for (int i = 0; i < samples; i++) checksum += countBits(bitboards[i]);
+        }
+        return checksum;
+    });
+
+    measure("ls1bIndex", (long long) samples * passes, [&]() {
+        U64 checksum = 0ULL;
+        for (int pass = 0; pass < passes; pass++) {
+            for (int i = 0; i < samples; i++) checksum += ls1bIndex(bitboards[i]);
+        }
+        return checksum;
+    });
+
+    // setOccupancy of random rook squares and subset indices
+    std::vector<int> squares(samples), indices(samples);
+    for (int i = 0; i < samples; i++) {
+        U64 r = nextRandom(state);
+        squares[i] = (int) (r & 63);
+        indices[i] = (int) (r >> 32) & ((1 << countBits(rookMasks[squares[i]])) - 1);
+    }
+
+    measure("setOccupancy rook", (long long) samples * passes / 8, [&]() {
+        U64 checksum = 0ULL;
+        for (int pass = 0; pass < passes / 8; pass++) {
+            for (int i = 0; i < samples; i++) {
+                U64 mask = rookMasks[squares[i]];
+                checksum += setOccupancy(indices[i], countBits(mask), mask);
+            }
+        }
+        return checksum;
+    });
+}
+
+/*********************\
+ ======================
+   Table Generation
+ ======================
+\*********************/
+
+// backend argument the compiler can't see through, keeps table generation from being constant folded
+int runtimeBackend(int backend) {
+    static volatile int opaque;
+    opaque = backend;
+    return opaque;
+}
+
+// wall time of generating the slider tables at runtime (they are compile time constants in the engine)
+void benchTableInit() {
+    measure("init_slider_attacks magic", 1, []() {
+        auto *table = new SliderAttacks<sliderTableSize(magicSliders)>(
+                init_slider_attacks<sliderTableSize(magicSliders)>(runtimeBackend(magicSliders)));
+        U64 checksum = table->attacks[sliderTableSize(magicSliders) - 1];
+        delete table;
+        return checksum;
+    });
+
+    measure("init_slider_attacks pext", 1, []() {
+        auto *table = new SliderAttacks<sliderTableSize(pextSliders)>(
+                init_slider_attacks<sliderTableSize(pextSliders)>(runtimeBackend(pextSliders)));
+        U64 checksum = table->attacks[sliderTableSize(pextSliders) - 1];
+        delete table;
+        return checksum;
+    });
+}
+
+// findMagicNumber of one square at the current table index bits
+struct MagicTiming {
+    int indexBits;
+    long long tries;
+    double milliseconds;
+};
+
+MagicTiming magicTimings[2][64];
+
+// time the magic search of every square with the default seed (single thread, reproducible tries)
+void benchFindMagics() {
+    for (int piece : {rook, bishop}) {
+        for (int square = 0; square < 64; square++) {
+            MagicTiming &timing = magicTimings[piece == bishop][square];
+            unsigned int state = magicSearchState(randomState, square, piece);
+
+            timing.indexBits = sliderIndexBits(magicSliders, piece, square);
+
+            long long start = getTimeNs();
+            benchSink += findMagicNumber(square, timing.indexBits, piece, state, 100000000, &timing.tries);
+            timing.milliseconds = (getTimeNs() - start) / 1e6;
+        }
+    }
+}
+
+/*********************\
+ ======================
+         Report
+ ======================
+\*********************/
+
+// cpu brand string (cpuid leaves 0x80000002 to 0x80000004)
+std::string cpuBrand() {
+#if PEXT_SUPPORTED
+    unsigned int brand[12] = {};
+    if (__get_cpuid(0x80000000, &brand[0], &brand[1], &brand[2], &brand[3]) && brand[0] >= 0x80000004) {
+        for (unsigned int leaf = 0; leaf < 3; leaf++) {
+            __get_cpuid(0x80000002 + leaf, &brand[leaf * 4], &brand[leaf * 4 + 1], &brand[leaf * 4 + 2],
+                        &brand[leaf * 4 + 3]);
+        }
+
+        std::string name((const char *) brand, sizeof(brand));
+        name = name.c_str();
+
+        // trim padding
+        size_t first = name.find_first_not_of(' ');
+        return first == std::string::npos ? "" : name.substr(first, name.find_last_not_of(' ') - first + 1);
+    }
+#endif
+    return "unknown";
+}
+
+#ifdef __VERSION__
+#define COMPILER_VERSION __VERSION__
+#elif defined(_MSC_FULL_VER)
+#define COMPILER_VERSION "msvc " + std::to_string(_MSC_FULL_VER)
+#else
+#define COMPILER_VERSION "unknown"
+#endif
+
+void printReport(bool magics) {
+    printf("{\n");
+    printf("  \"engine\": \"%s\",\n", ENGINE_NAME);
+    printf("  \"compiler\": \"%s\",\n", jsonEscape(COMPILER_VERSION).c_str());
+    printf("  \"cpu\": \"%s\",\n", jsonEscape(cpuBrand()).c_str());
+#ifdef __POPCNT__
+    printf("  \"popcnt\": true,\n");
+#else
+    printf("  \"popcnt\": false,\n");
+#endif
+    printf("  \"bmi2\": %s,\n", cpuHasBmi2() ? "true" : "false");
+    printf("  \"slider_backend\": \"%s\",\n", sliderBackendNames[sliderBackend]);
+    printf("  \"repetitions\": %d,\n", microRepetitions);
+
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < microResults.size(); i++) {
+        printf("    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops\": %lld}%s\n", microResults[i].name.c_str(),
+               microResults[i].nsPerOp, microResults[i].ops, i + 1 < microResults.size() ? "," : "");
+    }
+    printf("  ]%s\n", magics ? "," : "");
+
+    if (magics) {
+        printf("  \"find_magic\": {\n");
+        printf("    \"seed\": %u,\n", randomState);
+
+        for (int piece : {rook, bishop}) {
+            printf("    \"%s\": [\n", piece == bishop ? "bishop" : "rook");
+            for (int square = 0; square < 64; square++) {
+                MagicTiming &timing = magicTimings[piece == bishop][square];
+                printf("      {\"square\": \"%s\", \"index_bits\": %d, \"tries\": %lld, \"ms\": %.4f}%s\n",
+                       squareToCoordinates[square], timing.indexBits, timing.tries, timing.milliseconds,
+                       square < 63 ? "," : "");
+            }
+            printf("    ]%s\n", piece == rook ? "," : "");
+        }
+
+        printf("  }\n");
+    }
+
+    printf("}\n");
+}
+
+int main(int argc, char *argv[]) {
+    init_all();
+
+    bool magics = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "quick")) microRepetitions = 1;
+        else if (!strcmp(argv[i], "nomagics")) magics = false;
+    }
+
+    benchLookups();
+    benchBitPrimitives();
+    benchTableInit();
+
+    if (magics) {
+        benchFindMagics();
+    }
+
+    printReport(magics);
+
+    return 0;
+}